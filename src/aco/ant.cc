@@ -2,30 +2,78 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <limits>
-#include <random>
-#include <thread>
+
+#include "../matrixallocator.h"
 
 namespace {
 
 using ant::AntColony;
 
-double RandomValue() {
-  static std::random_device rd;
-  static std::mt19937 engine(rd());
-  static std::uniform_real_distribution<double> normal_distrib(0.0, 1.0);
+// SplitMix64 step: cheap to seed, so every ant can get its own stream
+std::uint64_t Mix(std::uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
 
-  return normal_distrib(engine);
+std::uint64_t Mix(std::uint64_t seed, std::uint64_t counter) {
+  return Mix(seed ^ Mix(counter));
 }
 
-std::vector<std::vector<double>> NormalizedGraph(
-    const SimpleGraph<int>& graph) {
-  const std::size_t sz = graph.Size();
+// Counter-based generator: the stream of an ant depends only on the solve
+// seed, the population number and the ant, never on which thread runs it.
+class Random {
+ public:
+  explicit Random(std::uint64_t seed) : state_{seed} {}
+
+  // uniform value in [0, 1)
+  double Value() {
+    state_ += 0x9e3779b97f4a7c15ULL;
+    return (Mix(state_) >> 11) * 0x1.0p-53;
+  }
+
+ private:
+  std::uint64_t state_;
+};
 
-  std::vector<std::vector<double>> normalized(sz, std::vector<double>(sz));
+const double alpha = 1.0;   // weight of the feromone on an edge
+const double beta = 4.0;    // weight of the edge closeness
+const double reduce = 0.6;  // share of the feromone left after evaporation
+const double Q = 320.0;     // feromone one ant spreads over its path
+const int search_neighbours = 10;  // neighbour list length for local search
+
+// Row-major square matrix whose rows start on cache line boundaries, padded
+// off aliasing widths; large ones are on huge pages
+class Matrix {
+ public:
+  Matrix(int size, double value)
+      : n_{size},
+        stride_{static_cast<int>(MatrixAllocator<double>::RowStride(size))},
+        data_(n_ * stride_, value) {}
+
+  int Size() const noexcept { return n_; }
+
+  double* operator[](int row) noexcept { return data_.data() + row * stride_; }
+  const double* operator[](int row) const noexcept {
+    return data_.data() + row * stride_;
+  }
 
-  for (std::size_t i = 0; i != sz; ++i)
-    for (std::size_t j = 0; j != sz; ++j) {
+ private:
+  int n_;
+  int stride_;
+  std::vector<double, MatrixAllocator<double>> data_;
+};
+
+Matrix NormalizedGraph(const SimpleGraph<int>& graph) {
+  const int sz = graph.Size();
+
+  Matrix normalized(sz, 0.0);
+
+  for (int i = 0; i != sz; ++i)
+    for (int j = 0; j != sz; ++j) {
       if ((graph[i][j] == 0 || graph[j][i] == 0) && i != j)
         throw std::runtime_error("Graph is not full");
 
@@ -36,70 +84,351 @@ std::vector<std::vector<double>> NormalizedGraph(
   return normalized;
 }
 
-int Roulette(const std::vector<double>& chance) {
+// dist^beta does not change during a solve, so it is computed only once
+Matrix HeuristicTable(const Matrix& dist) {
+  const int sz = dist.Size();
+
+  Matrix heuristic(sz, 0.0);
+  for (int i = 0; i != sz; ++i)
+    for (int j = 0; j != sz; ++j)
+      if (i != j) heuristic[i][j] = std::pow(dist[i][j], beta);
+
+  return heuristic;
+}
+
+// fero^alpha * dist^beta for every edge of rows [first_row, last_row),
+// refreshed after each feromone update
+void UpdateAttraction(Matrix& attraction, const Matrix& fero,
+                      const Matrix& heuristic, int first_row, int last_row) {
+  const int sz = attraction.Size();
+
+  for (int i = first_row; i != last_row; ++i)
+    for (int j = 0; j != sz; ++j)
+      attraction[i][j] = std::pow(fero[i][j], alpha) * heuristic[i][j];
+}
+
+// Buffers one worker reuses for every ant it builds a path for
+struct AntScratch {
+  explicit AntScratch(int sz) : wish(sz), visited(sz), position(sz) {}
+
+  std::vector<double> wish;
+  std::vector<char> visited;
+  std::vector<int> position;  // index of every vertex in a path
+};
+
+// Nearest neighbours of every vertex, closest first. Empty when k is 0.
+class CandidateLists {
+ public:
+  CandidateLists(const SimpleGraph<int>& graph, int k)
+      : k_{std::max(0, std::min(k, graph.Size() - 1))} {
+    const int sz = graph.Size();
+    if (k_ == 0) return;
+
+    data_.resize(static_cast<std::size_t>(sz) * k_);
+
+    std::vector<int> others(sz - 1);
+    for (int i = 0; i != sz; ++i) {
+      for (int j = 0, n = 0; j != sz; ++j)
+        if (j != i) others[n++] = j;
+
+      std::partial_sort(
+          others.begin(), others.begin() + k_, others.end(),
+          [&](int lhs, int rhs) { return graph[i][lhs] < graph[i][rhs]; });
+      std::copy(others.begin(), others.begin() + k_, data_.begin() + i * k_);
+    }
+  }
+
+  int Size() const noexcept { return k_; }
+
+  const int* operator[](int vertex) const noexcept {
+    return data_.data() + static_cast<std::size_t>(vertex) * k_;
+  }
+
+ private:
+  int k_;
+  std::vector<int> data_;
+};
+
+// Picks an index in [0, count) with probability proportional to its wish,
+// -1 if every wish is zero
+int Roulette(const double* wish, int count, double wish_sum, Random& rng) {
+  const double threshold = rng.Value() * wish_sum;
+
   int next_point = -1;
-  double cumulative_probability = 0.0;
+  double cumulative = 0.0;
 
-  for (std::size_t i = 0; i < chance.size() && next_point == -1; ++i) {
-    if (chance[i] > 0) {
-      cumulative_probability += chance[i];
-      if (RandomValue() <= cumulative_probability)
-        next_point = static_cast<int>(i);
+  for (int i = 0; i < count; ++i) {
+    if (wish[i] > 0) {
+      next_point = i;
+      cumulative += wish[i];
+      if (threshold < cumulative) break;
     }
   }
 
   return next_point;
 }
 
-AntColony::TsmResult MinimalSolution(
-    const std::vector<AntColony::TsmResult>& ants_data) {
-  AntColony::TsmResult min = ants_data[0];
+// index of the shortest path among ants [first, last)
+int MinimalSolution(const std::vector<AntColony::TsmResult>& ants_data,
+                    int first, int last) {
+  int min = first;
 
-  for (std::size_t i = 1; i != ants_data.size(); ++i) {
-    if (ants_data[i].distance < min.distance) min = ants_data[i];
+  for (int i = first + 1; i < last; ++i) {
+    if (ants_data[i].distance < ants_data[min].distance) min = i;
   }
 
   return min;
 }
 
-void UpdateFeromones(std::vector<std::vector<double>>& feromones,
-                     std::vector<AntColony::TsmResult>& paths) {
-  static const double reduce = 0.6;
-  static const double Q = 320.0;
-  static const int sz = feromones.size();
+bool Symmetric(const SimpleGraph<int>& graph) {
+  for (int i = 0; i != graph.Size(); ++i)
+    for (int j = 0; j != i; ++j)
+      if (graph[i][j] != graph[j][i]) return false;
 
-  for (int i = 0; i != sz; ++i)
+  return true;
+}
+
+// Improves a path with 2-opt and Or-opt moves until neither finds a shorter
+// one. Only moves that bring a vertex next to one of its nearest neighbours
+// are tried. 2-opt reverses a part of the path, so it is only used when the
+// graph is symmetric; Or-opt keeps the direction of the moved segment.
+struct LocalSearch {
+  const SimpleGraph<int>& gr;
+  const CandidateLists& neighbours;
+  const bool symmetric;
+
+  void operator()(AntColony::TsmResult& path, AntScratch& scratch) const {
+    const int sz = gr.Size();
+    if (sz < 5) return;
+
+    std::vector<int>& tour = path.vertices;
+    std::vector<int>& position = scratch.position;
+    const int start = tour[0];
+
+    for (int i = 0; i != sz; ++i) position[tour[i]] = i;
+
+    // every move makes the path strictly shorter, so this terminates
+    bool improved = true;
+    while (improved) {
+      improved = symmetric && TwoOpt(tour, position);
+      improved = OrOpt(tour, position) || improved;
+    }
+
+    // keep the path starting and ending at the vertex of its ant
+    std::rotate(tour.begin(), tour.begin() + position[start],
+                tour.begin() + sz);
+    tour[sz] = tour[0];
+
+    path.distance = 0;
+    for (int i = 0; i != sz; ++i) path.distance += gr[tour[i]][tour[i + 1]];
+  }
+
+ private:
+  static void Reverse(std::vector<int>& tour, std::vector<int>& position,
+                      int first, int last) {
+    std::reverse(tour.begin() + first, tour.begin() + last + 1);
+    for (int i = first; i <= last; ++i) position[tour[i]] = i;
+  }
+
+  // replaces edges (a, b) and (c, d) by (a, c) and (b, d)
+  bool TwoOpt(std::vector<int>& tour, std::vector<int>& position) const {
+    const int sz = gr.Size();
+    bool improved = false;
+
+    for (int i = 0; i != sz; ++i) {
+      const int a = tour[i];
+      const int b = tour[(i + 1) % sz];
+      const int* near = neighbours[a];
+
+      for (int k = 0; k != neighbours.Size(); ++k) {
+        const int c = near[k];
+        // neighbours are sorted, the next ones cannot be closer than b
+        if (gr[a][c] >= gr[a][b]) break;
+
+        const int j = position[c];
+        const int d = tour[(j + 1) % sz];
+        const long long delta =
+            0LL + gr[a][c] + gr[b][d] - gr[a][b] - gr[c][d];
+
+        if (delta < 0) {
+          if (i < j)
+            Reverse(tour, position, i + 1, j);
+          else
+            Reverse(tour, position, j + 1, i);
+          improved = true;
+          break;
+        }
+      }
+    }
+
+    return improved;
+  }
+
+  // moves up to three consecutive vertices between a neighbour of the first
+  // one and its successor
+  bool OrOpt(std::vector<int>& tour, std::vector<int>& position) const {
+    const int sz = gr.Size();
+    bool improved = false;
+
+    for (int len = 1; len <= 3; ++len) {
+      for (int i = 1; i + len < sz; ++i) {
+        const int first = tour[i];
+        const int last = tour[i + len - 1];
+        const int prev = tour[i - 1];
+        const int next = tour[i + len];
+        const long long removed =
+            0LL + gr[prev][first] + gr[last][next] - gr[prev][next];
+        const int* near = neighbours[first];
+
+        for (int k = 0; k != neighbours.Size(); ++k) {
+          const int c = near[k];
+          const int j = position[c];
+          // c inside the segment or right before it: nothing to move
+          if (j >= i - 1 && j < i + len) continue;
+
+          const int e = tour[(j + 1) % sz];
+          const long long added =
+              0LL + gr[c][first] + gr[last][e] - gr[c][e];
+
+          if (added < removed) {
+            if (j < i) {
+              std::rotate(tour.begin() + j + 1, tour.begin() + i,
+                          tour.begin() + i + len);
+              for (int p = j + 1; p < i + len; ++p) position[tour[p]] = p;
+            } else {
+              std::rotate(tour.begin() + i, tour.begin() + i + len,
+                          tour.begin() + j + 1);
+              for (int p = i; p <= j; ++p) position[tour[p]] = p;
+            }
+            improved = true;
+            break;
+          }
+        }
+      }
+    }
+
+    return improved;
+  }
+};
+
+void EvaporateFeromones(Matrix& feromones, int first_row, int last_row) {
+  const int sz = feromones.Size();
+
+  for (int i = first_row; i != last_row; ++i)
     for (int j = 0; j != sz; ++j) feromones[i][j] *= reduce;
+}
 
-  for (int ant = 0; ant < sz; ++ant) {
-    double delta_fero = Q / paths[ant].distance;
-    for (std::size_t i = 0; i < paths[ant].vertices.size() - 1; ++i) {
-      feromones[paths[ant].vertices[i]][paths[ant].vertices[i + 1]] +=
-          delta_fero;
+void UpdateFeromones(Matrix& feromones,
+                     const std::vector<AntColony::TsmResult>& paths) {
+  EvaporateFeromones(feromones, 0, feromones.Size());
+
+  for (const AntColony::TsmResult& path : paths) {
+    double delta_fero = Q / path.distance;
+    for (std::size_t i = 0; i < path.vertices.size() - 1; ++i) {
+      feromones[path.vertices[i]][path.vertices[i + 1]] += delta_fero;
     }
   }
 }
-std::vector<double> CalculateChances(
-    const std::vector<std::vector<double>>& dist,
-    const std::vector<std::vector<double>>& fero,
-    const std::vector<bool>& visited, int current_point) {
-  static const double alpha = 1.0;
-  static const double beta = 4.0;
 
-  std::vector<double> wish(dist.size());
-  for (size_t j = 0; j != dist.size(); ++j)
-    if (!visited[j])
-      wish[j] = std::pow(fero[current_point][j], alpha) *
-                std::pow(dist[current_point][j], beta);
+// Parallel counterpart of UpdateFeromones for the owner of feromone rows
+// [first_row, last_row): it walks every path for the edges leaving its own
+// rows, so no two workers ever write one row and nothing is staged.
+void ApplyFeromones(Matrix& feromones,
+                    const std::vector<AntColony::TsmResult>& paths,
+                    int first_row, int last_row) {
+  EvaporateFeromones(feromones, first_row, last_row);
+
+  // ants in ascending order, so every edge gets its deposits in the same
+  // order as in UpdateFeromones
+  for (const AntColony::TsmResult& path : paths) {
+    const double delta_fero = Q / path.distance;
+    for (std::size_t i = 0; i < path.vertices.size() - 1; ++i) {
+      const int from = path.vertices[i];
+      if (from >= first_row && from < last_row)
+        feromones[from][path.vertices[i + 1]] += delta_fero;
+    }
+  }
+}
 
-  double wish_sum = std::accumulate(wish.begin(), wish.end(), 0.0);
+// Fills scratch.wish with the attraction of every unvisited vertex and
+// returns their sum
+double CalculateChances(const Matrix& attraction, AntScratch& scratch,
+                        int current_point) {
+  const int sz = attraction.Size();
+  const double* row = attraction[current_point];
+
+  double wish_sum = 0.0;
+  for (int j = 0; j != sz; ++j) {
+    scratch.wish[j] = scratch.visited[j] ? 0.0 : row[j];
+    wish_sum += scratch.wish[j];
+  }
 
-  std::vector<double> chances(dist.size());
-  for (size_t j = 0; j != dist.size(); ++j) chances[j] = wish[j] / wish_sum;
+  return wish_sum;
+}
 
-  return chances;
+// Same for the candidate list of current_point only: scratch.wish[i] belongs
+// to the i-th candidate
+double CandidateChances(const Matrix& attraction,
+                        const CandidateLists& candidates, AntScratch& scratch,
+                        int current_point) {
+  const double* row = attraction[current_point];
+  const int* near = candidates[current_point];
+
+  double wish_sum = 0.0;
+  for (int i = 0; i != candidates.Size(); ++i) {
+    scratch.wish[i] = scratch.visited[near[i]] ? 0.0 : row[near[i]];
+    wish_sum += scratch.wish[i];
+  }
+
+  return wish_sum;
 }
 
+// Checks the limits of a StopCondition after every population
+class Termination {
+ public:
+  explicit Termination(const AntColony::StopCondition& stop)
+      : stop_{stop},
+        start_{std::chrono::steady_clock::now()},
+        best_{std::numeric_limits<double>::max()},
+        improved_at_{0} {
+    if (stop.iterations <= 0 && stop.time_limit.count() <= 0 &&
+        stop.target <= 0 && stop.stale_iterations <= 0)
+      throw std::invalid_argument("No stop condition");
+  }
+
+  // iterations is the number of populations run so far, best the shortest
+  // distance found by them
+  bool Done(int iterations, double best) {
+    if (best < best_) {
+      best_ = best;
+      improved_at_ = iterations;
+    }
+
+    return (stop_.iterations > 0 && iterations >= stop_.iterations) ||
+           (stop_.target > 0 && best_ <= stop_.target) ||
+           (stop_.stale_iterations > 0 &&
+            iterations - improved_at_ >= stop_.stale_iterations) ||
+           OutOfTime();
+  }
+
+  bool OutOfTime() const {
+    return stop_.time_limit.count() > 0 &&
+           std::chrono::steady_clock::now() - start_ >= stop_.time_limit;
+  }
+
+  // populations that may still run before the iteration limit
+  int Remaining(int iterations) const {
+    return stop_.iterations > 0 ? stop_.iterations - iterations
+                                : std::numeric_limits<int>::max();
+  }
+
+ private:
+  const AntColony::StopCondition stop_;
+  const std::chrono::steady_clock::time_point start_;
+  double best_;
+  int improved_at_;
+};
+
 }  // namespace
 
 namespace ant {
@@ -107,30 +436,50 @@ namespace ant {
 struct CreatePathForOneAnt {
   const SimpleGraph<int>& gr;
   AntColony::TsmResult& tsm;
-  const std::vector<std::vector<double>>& d;
-  const std::vector<std::vector<double>>& f;
+  const Matrix& attraction;
+  const CandidateLists& candidates;
+  AntScratch& scratch;
+  Random rng;
 
   CreatePathForOneAnt(const SimpleGraph<int>& aco, AntColony::TsmResult& t_,
-                      std::vector<std::vector<double>>& d_,
-                      std::vector<std::vector<double>>& f_)
-      : gr{aco}, tsm{t_}, d{d_}, f{f_} {}
+                      const Matrix& a_, const CandidateLists& c_,
+                      AntScratch& s_, std::uint64_t seed)
+      : gr{aco},
+        tsm{t_},
+        attraction{a_},
+        candidates{c_},
+        scratch{s_},
+        rng{seed} {}
+
+  int NextPoint(int curr_point) {
+    if (candidates.Size() > 0) {
+      double wish_sum =
+          CandidateChances(attraction, candidates, scratch, curr_point);
+      int next =
+          Roulette(scratch.wish.data(), candidates.Size(), wish_sum, rng);
+      if (next != -1) return candidates[curr_point][next];
+      // every neighbour is visited already, fall back to the full scan
+    }
+
+    double wish_sum = CalculateChances(attraction, scratch, curr_point);
+    return Roulette(scratch.wish.data(), gr.Size(), wish_sum, rng);
+  }
 
   void operator()(int ant) {
     int curr_point = ant;
     const int sz = gr.Size();
 
-    std::vector<bool> visited(sz, false);
+    std::fill(scratch.visited.begin(), scratch.visited.end(), 0);
 
     tsm.vertices[0] = tsm.vertices[sz] = curr_point;
+    tsm.distance = 0;
 
     // creating the path for ant No.i
     for (int i = 0; i < sz - 1; ++i) {
-      visited[curr_point] = true;
-
-      std::vector<double> chances = CalculateChances(d, f, visited, curr_point);
+      scratch.visited[curr_point] = 1;
 
       int prev_point = curr_point;
-      curr_point = Roulette(chances);  // choose the next vertex to go
+      curr_point = NextPoint(curr_point);  // choose the next vertex to go
 
       if (curr_point == -1)
         throw std::runtime_error("Cannot find the solution");
@@ -143,63 +492,207 @@ struct CreatePathForOneAnt {
   }
 };
 
-AntColony::TsmResult AntColony::ClassicSolve(const SimpleGraph<int>& g, int n) {
-  const int sz = g.Size();
-  if (sz == 0) throw std::invalid_argument("Empty graph");
-
-  TsmResult min_path{{}, std::numeric_limits<double>::max()};
-
-  std::vector<std::vector<double>> dist = NormalizedGraph(g);
-  std::vector<std::vector<double>> fero(sz, std::vector<double>(sz, 0.2));
+// Feromone trail and ants of one colony evolving on a single thread
+struct Colony {
+  const SimpleGraph<int>& gr;
+  const Matrix& heuristic;
+  const CandidateLists& candidates;
+  const LocalSearch* search;  // nullptr without local search
+
+  Matrix fero;
+  Matrix attraction;
+  std::vector<AntColony::TsmResult> ants_path;
+  AntScratch scratch;
+  AntColony::TsmResult best;
+  int populations;
+
+  Colony(const SimpleGraph<int>& g, const Matrix& h, const CandidateLists& c,
+         const LocalSearch* s)
+      : gr{g},
+        heuristic{h},
+        candidates{c},
+        search{s},
+        fero(g.Size(), 0.2),
+        attraction(g.Size(), 0.0),
+        ants_path(g.Size(), {std::vector<int>(g.Size() + 1, 0), 0}),
+        scratch(g.Size()),
+        best{{}, std::numeric_limits<double>::max()},
+        populations{0} {
+    UpdateAttraction(attraction, fero, heuristic, 0, gr.Size());
+  }
 
-  for (int iter = 0; iter < n; ++iter) {  // number of populations
-    std::vector<TsmResult> ants_path(sz, {std::vector<int>(sz + 1, 0), 0});
+  void Population(std::uint64_t seed) {
+    const int sz = gr.Size();
 
     for (int ant = 0; ant < sz;
          ++ant) {  // ants number is always equal to vertex number
-      CreatePathForOneAnt(g, ants_path[ant], dist, fero)(ant);
+      CreatePathForOneAnt(gr, ants_path[ant], attraction, candidates, scratch,
+                          Mix(seed, ant))(ant);
     }
 
+    if (search)
+      (*search)(ants_path[MinimalSolution(ants_path, 0, sz)], scratch);
+
     UpdateFeromones(fero, ants_path);
+    UpdateAttraction(attraction, fero, heuristic, 0, sz);
 
-    if (min_path.distance > MinimalSolution(ants_path).distance)
-      min_path = MinimalSolution(ants_path);
+    // only an improvement is copied, into storage kept from the last one
+    const AntColony::TsmResult& min =
+        ants_path[MinimalSolution(ants_path, 0, sz)];
+    if (best.distance > min.distance) best = min;
+    ++populations;
   }
 
-  return min_path;
+  // lays the feromone of a path found by another colony
+  void Immigrate(const AntColony::TsmResult& path) {
+    const double delta_fero = Q / path.distance;
+    for (std::size_t i = 0; i < path.vertices.size() - 1; ++i)
+      fero[path.vertices[i]][path.vertices[i + 1]] += delta_fero;
+
+    UpdateAttraction(attraction, fero, heuristic, 0, gr.Size());
+
+    if (best.distance > path.distance) best = path;
+  }
+};
+
+AntColony::TsmResult AntColony::ClassicSolve(const SimpleGraph<int>& g,
+                                             const StopCondition& stop) {
+  const int sz = g.Size();
+  if (sz == 0) throw std::invalid_argument("Empty graph");
+
+  Termination termination(stop);
+  const std::uint64_t run_seed = Mix(seed_, runs_++);
+
+  const Matrix heuristic = HeuristicTable(NormalizedGraph(g));
+  const CandidateLists candidates(g, candidates_);
+  const CandidateLists neighbours(g, local_search_ ? search_neighbours : 0);
+  const LocalSearch search{g, neighbours, Symmetric(g)};
+
+  Colony colony(g, heuristic, candidates, local_search_ ? &search : nullptr);
+
+  int iter = 0;
+  do {  // populations
+    colony.Population(Mix(run_seed, iter));
+  } while (!termination.Done(++iter, colony.best.distance));
+
+  colony.best.iterations = iter;
+  return colony.best;
 }
 
 AntColony::TsmResult AntColony::ParallelSolve(const SimpleGraph<int>& g,
-                                              int n) {
+                                              const StopCondition& stop) {
   const int sz = g.Size();
   if (sz == 0) throw std::invalid_argument("Empty graph");
 
+  Termination termination(stop);
   TsmResult min_path{{}, std::numeric_limits<double>::max()};
+  const std::uint64_t run_seed = Mix(seed_, runs_++);
+
+  const Matrix heuristic = HeuristicTable(NormalizedGraph(g));
+  Matrix fero(sz, 0.2);
+  Matrix attraction(sz, 0.0);
+  const CandidateLists candidates(g, candidates_);
+  const CandidateLists neighbours(g, local_search_ ? search_neighbours : 0);
+  const LocalSearch search{g, neighbours, Symmetric(g)};
+
+  std::vector<TsmResult> ants_path(sz, {std::vector<int>(sz + 1, 0), 0});
+  std::vector<AntScratch> scratch(pool_.Size(), AntScratch(sz));
+
+  pool_.ParallelFor(sz, [&](int, int first_row, int last_row) {
+    UpdateAttraction(attraction, fero, heuristic, first_row, last_row);
+  });
+
+  int iter = 0;
+  do {  // populations
+    // every worker builds the paths for its own block of ants
+    pool_.ParallelFor(sz, [&](int worker, int first_ant, int last_ant) {
+      for (int ant = first_ant; ant != last_ant; ++ant)
+        CreatePathForOneAnt(g, ants_path[ant], attraction, candidates,
+                            scratch[worker],
+                            Mix(Mix(run_seed, iter), ant))(ant);
+
+      // improves the best path of its block before the feromone is left
+      if (local_search_)
+        search(ants_path[MinimalSolution(ants_path, first_ant, last_ant)],
+               scratch[worker]);
+    });
+
+    // and then evaporates, deposits and refreshes its own block of rows
+    pool_.ParallelFor(sz, [&](int, int first_row, int last_row) {
+      ApplyFeromones(fero, ants_path, first_row, last_row);
+      UpdateAttraction(attraction, fero, heuristic, first_row, last_row);
+    });
+
+    // only an improvement is copied, into storage kept from the last one
+    const TsmResult& best = ants_path[MinimalSolution(ants_path, 0, sz)];
+    if (min_path.distance > best.distance) min_path = best;
+  } while (!termination.Done(++iter, min_path.distance));
+
+  min_path.iterations = iter;
+  return min_path;
+}
 
-  std::vector<std::vector<double>> dist = NormalizedGraph(g);
-  std::vector<std::vector<double>> fero(sz, std::vector<double>(sz, 0.2));
-
-  std::vector<std::thread> threads;
+AntColony::TsmResult AntColony::IslandSolve(const SimpleGraph<int>& g,
+                                            const StopCondition& stop,
+                                            int islands, int interval,
+                                            Migration migration) {
+  const int sz = g.Size();
+  if (sz == 0) throw std::invalid_argument("Empty graph");
+  if (islands < 1 || interval < 1)
+    throw std::invalid_argument("Islands and interval should be positive");
 
-  for (int iter = 0; iter < n; ++iter) {  // number of populations
-    std::vector<TsmResult> ants_path(sz, {std::vector<int>(sz + 1, 0), 0});
+  Termination termination(stop);
+  const std::uint64_t run_seed = Mix(seed_, runs_++);
 
-    threads.clear();
+  const Matrix heuristic = HeuristicTable(NormalizedGraph(g));
+  const CandidateLists candidates(g, candidates_);
+  const CandidateLists neighbours(g, local_search_ ? search_neighbours : 0);
+  const LocalSearch search{g, neighbours, Symmetric(g)};
 
-    for (int ant = 0; ant < sz; ++ant) {
-      threads.emplace_back(CreatePathForOneAnt(g, ants_path[ant], dist, fero),
-                           ant);
-    }
+  std::vector<Colony> colonies;
+  colonies.reserve(islands);
+  for (int i = 0; i != islands; ++i)
+    colonies.emplace_back(g, heuristic, candidates,
+                          local_search_ ? &search : nullptr);
 
-    std::for_each(threads.begin(), threads.end(),
-                  [](std::thread& t) { t.join(); });
+  // best paths of the last epoch, read by the colonies they migrate to
+  std::vector<TsmResult> migrants(islands);
+  TsmResult min_path{{}, std::numeric_limits<double>::max()};
 
-    UpdateFeromones(fero, ants_path);
+  int iter = 0;
+  do {  // epochs of `interval` populations, synchronised only in between
+    const int epoch = std::min(interval, termination.Remaining(iter));
+
+    pool_.ParallelFor(islands, [&](int, int first, int last) {
+      for (int i = first; i != last; ++i) {
+        Colony& colony = colonies[i];
+
+        if (iter > 0) {
+          if (migration == RING)
+            colony.Immigrate(migrants[(i + islands - 1) % islands]);
+          else if (colony.best.distance > min_path.distance)
+            colony.Immigrate(min_path);
+        }
+
+        const std::uint64_t island_seed = Mix(run_seed, i);
+        for (int k = 0; k != epoch; ++k) {
+          if (colony.populations > 0 && termination.OutOfTime()) break;
+          colony.Population(Mix(island_seed, colony.populations));
+        }
+      }
+    });
+
+    for (int i = 0; i != islands; ++i) {
+      migrants[i] = colonies[i].best;
+      if (min_path.distance > migrants[i].distance) min_path = migrants[i];
+    }
 
-    if (min_path.distance > MinimalSolution(ants_path).distance)
-      min_path = MinimalSolution(ants_path);
-  }
+    iter = 0;
+    for (const Colony& colony : colonies)
+      iter = std::max(iter, colony.populations);
+  } while (!termination.Done(iter, min_path.distance));
 
+  min_path.iterations = iter;
   return min_path;
 }
 
@@ -1,7 +1,12 @@
 #ifndef ACO_H_
 #define ACO_H_
 
+#include <chrono>
+#include <cstdint>
+#include <random>
+
 #include "../simplegraph.h"
+#include "../threadpool.h"
 
 namespace ant {
 
@@ -10,15 +15,77 @@ class AntColony {
   struct TsmResult {
     std::vector<int> vertices;
     double distance{0};
+    int iterations{0};  // populations run before the solve stopped
+  };
+
+  // A solve stops as soon as any of the set limits is reached. Zero means
+  // the limit is not set; at least one of them has to be.
+  struct StopCondition {
+    int iterations{0};                         // number of populations
+    std::chrono::milliseconds time_limit{0};   // wall clock budget
+    double target{0};                          // distance that is good enough
+    int stale_iterations{0};                   // populations without progress
   };
 
-  static TsmResult ClassicSolve(const SimpleGraph<int>& g, int n);
-  static TsmResult ParallelSolve(const SimpleGraph<int>& g, int n);
+  enum Migration { RING = 0, BROADCAST };
+
+  // threads < 1 means one worker per hardware thread
+  explicit AntColony(int threads = 0)
+      : pool_{threads},
+        seed_{std::random_device{}()},
+        runs_{0},
+        candidates_{0},
+        local_search_{false} {}
+
+  TsmResult ClassicSolve(const SimpleGraph<int>& g, const StopCondition& stop);
+  TsmResult ParallelSolve(const SimpleGraph<int>& g,
+                          const StopCondition& stop);
+
+  // n populations
+  TsmResult ClassicSolve(const SimpleGraph<int>& g, int n) {
+    return ClassicSolve(g, StopCondition{n});
+  }
+  TsmResult ParallelSolve(const SimpleGraph<int>& g, int n) {
+    return ParallelSolve(g, StopCondition{n});
+  }
+
+  // Runs `islands` independent colonies spread over the worker threads, each
+  // with its own feromone and random stream. Every `interval` populations the
+  // colonies meet: each one gets the best path of the previous island (RING)
+  // or the best path of all (BROADCAST) and lays its feromone. Iteration
+  // limits count the populations of one island.
+  TsmResult IslandSolve(const SimpleGraph<int>& g, const StopCondition& stop,
+                        int islands, int interval,
+                        Migration migration = RING);
+
+  int get_threads() const noexcept { return pool_.Size(); }
+
+  // Every solve draws its randomness from (seed, number of solves since the
+  // seed was set), so re-setting the seed replays the same sequence of tours.
+  // Without local search the tours do not depend on the thread count either.
+  std::uint64_t get_seed() const noexcept { return seed_; }
+  void set_seed(std::uint64_t seed) noexcept {
+    seed_ = seed;
+    runs_ = 0;
+  }
+
+  // With k > 0 an ant only chooses among the k nearest unvisited neighbours
+  // of its vertex and scans the whole graph only when all of them are
+  // visited. 0 (the default) always scans the whole graph.
+  int get_candidates() const noexcept { return candidates_; }
+  void set_candidates(int k) noexcept { candidates_ = k; }
+
+  // Runs 2-opt and Or-opt on the best path of every worker in each
+  // population before the feromone is updated
+  bool get_local_search() const noexcept { return local_search_; }
+  void set_local_search(bool on) noexcept { local_search_ = on; }
 
  private:
-  void CreatePathForCurrentAnt(TsmResult& path, int current_ant, int sz,
-                               const std::vector<std::vector<double>>& dist,
-                               const std::vector<std::vector<double>>& fero);
+  ThreadPool pool_;
+  std::uint64_t seed_;
+  std::uint64_t runs_;
+  int candidates_;
+  bool local_search_;
 };
 
 }  // namespace ant
@@ -140,12 +140,12 @@ void Console::Run() {
             parallel_aco_win = newwin(5, maxx / 2, maxy - 6, maxx / 2);
 
             try {
-              AntColony::TsmResult classic_res = AntColony::ClassicSolve(g, 25);
+              AntColony::TsmResult classic_res = colony.ClassicSolve(g, 25);
               int executions = exec_num;
 
               auto t1 = std::chrono::high_resolution_clock::now();
               while (--executions) {
-                auto tmp = AntColony::ClassicSolve(g, 25);
+                auto tmp = colony.ClassicSolve(g, 25);
                 if (tmp.distance < classic_res.distance) classic_res = tmp;
               }
               auto t2 = std::chrono::high_resolution_clock::now();
@@ -154,11 +154,11 @@ void Console::Run() {
               print_result_window(classic_aco_win, classic_res,
                                   ms_double.count());
 
-              auto parallel_res = AntColony::ParallelSolve(g, 25);
+              auto parallel_res = colony.ParallelSolve(g, 25);
               executions = exec_num;
               t1 = std::chrono::high_resolution_clock::now();
               while (--executions) {
-                auto tmp = AntColony::ParallelSolve(g, 25);
+                auto tmp = colony.ParallelSolve(g, 25);
                 if (tmp.distance < parallel_res.distance) parallel_res = tmp;
               }
               t2 = std::chrono::high_resolution_clock::now();
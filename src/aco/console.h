@@ -19,6 +19,7 @@ class Console final : public BaseConsole {
 
  private:
   SimpleGraph<int> g;
+  AntColony colony;  // keeps its worker threads between runs
 };
 
 }  // namespace ant
@@ -0,0 +1,120 @@
+#include "banded.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "gauss.h"
+#include "kernels.h"
+
+namespace gaussmethod {
+
+void BandLU::Factor(const SimpleGraph<double>& a, int lower, int upper) {
+  const int n = a.get_rows();
+  if (n == 0 || a.get_cols() < n)
+    throw std::invalid_argument("LU needs a square (or augmented) matrix");
+
+  int found_lower = 0, found_upper = 0;
+  for (int i = 0; i != n; ++i)
+    for (int j = 0; j != n; ++j)
+      if (a[i][j] != 0) {
+        found_lower = std::max(found_lower, i - j);
+        found_upper = std::max(found_upper, j - i);
+      }
+
+  if ((lower >= 0 && lower < found_lower) ||
+      (upper >= 0 && upper < found_upper))
+    throw std::invalid_argument("Matrix has entries outside of the band");
+
+  Reset(n, lower < 0 ? found_lower : lower, upper < 0 ? found_upper : upper);
+  for (int i = 0; i != n; ++i)
+    for (int j = std::max(0, i - lower_); j <= std::min(n - 1, i + upper_);
+         ++j)
+      At(i, j) = a[i][j];
+
+  Eliminate();
+}
+
+void BandLU::Factor(const CsrMatrix& a, int lower, int upper) {
+  a.Check();
+  const int n = a.rows;
+  if (n == 0 || a.cols != n)
+    throw std::invalid_argument("LU needs a square matrix");
+
+  int found_lower = 0, found_upper = 0;
+  for (int i = 0; i != n; ++i)
+    for (int k = a.row_start[i]; k != a.row_start[i + 1]; ++k) {
+      found_lower = std::max(found_lower, i - a.col_index[k]);
+      found_upper = std::max(found_upper, a.col_index[k] - i);
+    }
+
+  if ((lower >= 0 && lower < found_lower) ||
+      (upper >= 0 && upper < found_upper))
+    throw std::invalid_argument("Matrix has entries outside of the band");
+
+  Reset(n, lower < 0 ? found_lower : lower, upper < 0 ? found_upper : upper);
+  for (int i = 0; i != n; ++i)
+    for (int k = a.row_start[i]; k != a.row_start[i + 1]; ++k)
+      At(i, a.col_index[k]) += a.values[k];
+
+  Eliminate();
+}
+
+void BandLU::Reset(int n, int lower, int upper) {
+  n_ = n;
+  lower_ = lower;
+  upper_ = upper;
+  singular_ = false;
+  band_.assign(static_cast<std::size_t>(n) * Width(), 0);
+  pivots_.resize(n);
+}
+
+void BandLU::Eliminate() {
+  for (int k = 0; k != n_; ++k) {
+    const int last_row = std::min(n_ - 1, k + lower_);
+    const int last_col = std::min(n_ - 1, k + lower_ + upper_);
+
+    int p = k;
+    for (int i = k + 1; i <= last_row; ++i)
+      if (std::abs(At(i, k)) > std::abs(At(p, k))) p = i;
+
+    pivots_[k] = p;
+    if (p != k)
+      for (int j = k; j <= last_col; ++j) std::swap(At(k, j), At(p, j));
+
+    const double pivot = At(k, k);
+    if (std::abs(pivot) < Gauss::EPS) {
+      singular_ = true;
+      for (int i = k + 1; i <= last_row; ++i) At(i, k) = 0;
+      continue;
+    }
+
+    for (int i = k + 1; i <= last_row; ++i) {
+      const double l = At(i, k) /= pivot;
+      if (l == 0 || last_col == k) continue;
+      SubtractRow(&At(i, k + 1), &At(k, k + 1), l, last_col - k, false);
+    }
+  }
+}
+
+void BandLU::Solve(const std::vector<double>& b, std::vector<double>& x) const {
+  if (static_cast<int>(b.size()) != n_)
+    throw std::invalid_argument("Right-hand side of a wrong size");
+  if (singular_) throw std::runtime_error("Matrix is singular");
+
+  x = b;
+  for (int k = 0; k != n_; ++k) {
+    std::swap(x[k], x[pivots_[k]]);
+    for (int i = k + 1; i <= std::min(n_ - 1, k + lower_); ++i)
+      x[i] -= At(i, k) * x[k];
+  }
+
+  for (int i = n_ - 1; i >= 0; --i) {
+    double sum = x[i];
+    for (int k = i + 1; k <= std::min(n_ - 1, i + lower_ + upper_); ++k)
+      sum -= At(i, k) * x[k];
+    x[i] = sum / At(i, i);
+  }
+}
+
+}  // namespace gaussmethod
@@ -0,0 +1,60 @@
+#ifndef GAUSS_BANDED_H_
+#define GAUSS_BANDED_H_
+
+#include <vector>
+
+#include "../matrixallocator.h"
+#include "../simplegraph.h"
+#include "sparse.h"
+
+namespace gaussmethod {
+
+// P * A = L * U factorisation with partial pivoting of a matrix whose
+// entries all lie within lower diagonals below and upper diagonals above
+// the main one. Only the band is stored and eliminated, so factoring costs
+// O(n * lower * (lower + upper)) instead of O(n^3).
+class BandLU {
+ public:
+  BandLU() : n_{0}, lower_{0}, upper_{0}, singular_{false} {}
+
+  // Factors the leading rows x rows block of a, so an augmented matrix of
+  // Gauss::Solve can be passed as is. Negative bandwidths are detected from
+  // the entries that are not zero; given ones must cover all of them.
+  void Factor(const SimpleGraph<double>& a, int lower = -1, int upper = -1);
+  void Factor(const CsrMatrix& a, int lower = -1, int upper = -1);
+
+  int Size() const noexcept { return n_; }
+  int Lower() const noexcept { return lower_; }
+  int Upper() const noexcept { return upper_; }
+  bool Singular() const noexcept { return singular_; }
+
+  // x = A^-1 * b, throws std::runtime_error for a singular matrix
+  void Solve(const std::vector<double>& b, std::vector<double>& x) const;
+
+ private:
+  // Row i keeps columns [i - lower_, i + lower_ + upper_]: pivoting can
+  // move a row up to lower_ places, widening U by as many diagonals.
+  int Width() const noexcept { return 2 * lower_ + upper_ + 1; }
+  double& At(int i, int j) noexcept {
+    return band_[static_cast<std::size_t>(i) * Width() + j - i + lower_];
+  }
+  double At(int i, int j) const noexcept {
+    return band_[static_cast<std::size_t>(i) * Width() + j - i + lower_];
+  }
+
+  void Reset(int n, int lower, int upper);
+  void Eliminate();
+
+  int n_;
+  int lower_;
+  int upper_;
+  bool singular_;
+  // L multipliers left of the diagonal, not swapped by later pivots as in
+  // LAPACK gbtrf, and U on and right of it
+  std::vector<double, MatrixAllocator<double>> band_;
+  std::vector<int> pivots_;  // row k was swapped with row pivots_[k]
+};
+
+}  // namespace gaussmethod
+
+#endif  // GAUSS_BANDED_H_
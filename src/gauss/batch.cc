@@ -0,0 +1,195 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "../simd.h"
+#include "gauss.h"
+#include "parallel.h"
+
+namespace gaussmethod {
+
+SystemBatch::SystemBatch(int count, int n) : count_{count}, n_{n} {
+  if (count < 1 || n < 2)
+    throw std::invalid_argument("A batch needs systems of 2 or more unknowns");
+
+  data_.assign(Packs() * PackSize(), 0);
+  for (int s = count_; s != Packs() * lanes; ++s)
+    for (int i = 0; i != n_; ++i) At(s, i, i) = 1;
+}
+
+void SystemBatch::Set(int s, const SimpleGraph<double>& matr) {
+  if (matr.get_rows() != n_ || matr.get_cols() != n_ + 1)
+    throw std::invalid_argument("System of a wrong size for the batch");
+
+  for (int i = 0; i != n_; ++i)
+    for (int j = 0; j <= n_; ++j) At(s, i, j) = matr[i][j];
+}
+
+SimpleGraph<double> SystemBatch::Get(int s) const {
+  SimpleGraph<double> matr(n_, n_ + 1);
+  for (int i = 0; i != n_; ++i)
+    for (int j = 0; j <= n_; ++j) matr[i][j] = At(s, i, j);
+  return matr;
+}
+
+namespace {
+
+constexpr int lanes = SystemBatch::lanes;
+
+// x[l] -= c[l] * p[l] for every lane; the rows never overlap
+inline __attribute__((always_inline)) void LanesSubtract(
+    double* __restrict x, const double* __restrict p,
+    const double* __restrict c) {
+  for (int l = 0; l != lanes; ++l) x[l] -= c[l] * p[l];
+}
+
+// Gaussian elimination with partial pivoting of packs [first, last), all
+// lanes of a pack in step. A lane whose column has no pivot above EPS is
+// copied out as it is then, to be classified by Gauss::Solve; it goes on
+// with a unit pivot so the rest of the pack stays finite. Compiled once per
+// vector extension below, the lane loops becoming single instructions.
+inline __attribute__((always_inline)) void SolvePacksGeneric(
+    SystemBatch& batch, int first, int last, double* answers, int* statuses) {
+  const int n = batch.Size();
+  const int w = n + 1;
+
+  std::vector<double> x(static_cast<std::size_t>(n) * lanes);
+  std::vector<std::pair<int, SimpleGraph<double>>> singular;
+  std::vector<double> answer;
+
+  for (int pack = first; pack != last; ++pack) {
+    double* a = batch.Pack(pack);
+    auto entry = [&](int i, int j) { return a + (i * w + j) * lanes; };
+    bool lost[lanes] = {};
+    singular.clear();
+
+    for (int k = 0; k != n; ++k) {
+      for (int l = 0; l != lanes; ++l) {
+        int p = k;
+        for (int i = k + 1; i != n; ++i)
+          if (std::abs(entry(i, k)[l]) > std::abs(entry(p, k)[l])) p = i;
+
+        if (std::abs(entry(p, k)[l]) < Gauss::EPS) {
+          const int s = pack * lanes + l;
+          if (!lost[l] && s < batch.Count()) {
+            // eliminated entries were never written back as zeros
+            SimpleGraph<double> matr = batch.Get(s);
+            for (int i = 1; i != n; ++i)
+              for (int j = 0; j != std::min(i, k); ++j) matr[i][j] = 0;
+            singular.push_back({s, std::move(matr)});
+          }
+          lost[l] = true;
+          for (int i = k; i != n; ++i) entry(i, k)[l] = i == k;
+          continue;
+        }
+
+        if (p != k)
+          for (int j = k; j != w; ++j)
+            std::swap(entry(k, j)[l], entry(p, j)[l]);
+      }
+
+      double inverse[lanes];
+      for (int l = 0; l != lanes; ++l) inverse[l] = 1 / entry(k, k)[l];
+
+      for (int i = k + 1; i != n; ++i) {
+        double coef[lanes];
+        for (int l = 0; l != lanes; ++l)
+          coef[l] = entry(i, k)[l] * inverse[l];
+        for (int j = k + 1; j != w; ++j)
+          LanesSubtract(entry(i, j), entry(k, j), coef);
+      }
+    }
+
+    // back substitution, x[i * lanes + l] for unknown i of lane l
+    for (int i = n - 1; i >= 0; --i) {
+      double* xi = &x[i * lanes];
+      for (int l = 0; l != lanes; ++l) xi[l] = entry(i, n)[l];
+      for (int j = i + 1; j != n; ++j)
+        LanesSubtract(xi, &x[j * lanes], entry(i, j));
+      for (int l = 0; l != lanes; ++l) xi[l] /= entry(i, i)[l];
+    }
+
+    for (int l = 0; l != lanes; ++l) {
+      const int s = pack * lanes + l;
+      if (s >= batch.Count() || lost[l]) continue;
+      statuses[s] = Gauss::ONE;
+      for (int i = 0; i != n; ++i)
+        answers[static_cast<std::size_t>(s) * n + i] = x[i * lanes + l];
+    }
+
+    for (auto& [s, matr] : singular) {
+      statuses[s] = Gauss::Solve(std::move(matr), answer);
+      for (int i = 0; i != n; ++i)
+        answers[static_cast<std::size_t>(s) * n + i] = answer[i];
+    }
+  }
+}
+
+using SolvePacksKernel = void (*)(SystemBatch&, int, int, double*, int*);
+
+void SolvePacksScalar(SystemBatch& batch, int first, int last,
+                      double* answers, int* statuses) {
+  SolvePacksGeneric(batch, first, last, answers, statuses);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2"))) void SolvePacksAvx2(SystemBatch& batch,
+                                                    int first, int last,
+                                                    double* answers,
+                                                    int* statuses) {
+  SolvePacksGeneric(batch, first, last, answers, statuses);
+}
+
+__attribute__((target("avx512f"))) void SolvePacksAvx512(SystemBatch& batch,
+                                                         int first, int last,
+                                                         double* answers,
+                                                         int* statuses) {
+  SolvePacksGeneric(batch, first, last, answers, statuses);
+}
+
+#endif
+
+SolvePacksKernel ChooseSolvePacks() {
+#if defined(__x86_64__) || defined(__i386__)
+  switch (DetectSimd()) {
+    case SIMD_AVX512:
+      return SolvePacksAvx512;
+    case SIMD_AVX2:
+      return SolvePacksAvx2;
+    default:
+      break;
+  }
+#endif
+  return SolvePacksScalar;
+}
+
+}  // namespace
+
+void Gauss::BatchSolve(SystemBatch& batch, std::vector<double>& answers,
+                       std::vector<int>& statuses) {
+  BatchSolve(batch, answers, statuses, DefaultPool());
+}
+
+void Gauss::BatchSolve(SystemBatch& batch, std::vector<double>& answers,
+                       std::vector<int>& statuses, ThreadPool& pool) {
+  static const SolvePacksKernel kernel = ChooseSolvePacks();
+
+  answers.resize(static_cast<std::size_t>(batch.Count()) * batch.Size());
+  statuses.resize(batch.Count());
+
+  const int packs = batch.Packs();
+  if (pool.Size() == 1 || packs == 1) {
+    kernel(batch, 0, packs, answers.data(), statuses.data());
+    return;
+  }
+
+  pool.ParallelFor(packs, [&](int, int first, int last) {
+    kernel(batch, first, last, answers.data(), statuses.data());
+  });
+}
+
+}  // namespace gaussmethod
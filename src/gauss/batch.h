@@ -0,0 +1,57 @@
+#ifndef GAUSS_BATCH_H_
+#define GAUSS_BATCH_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "../matrixallocator.h"
+#include "../simplegraph.h"
+
+namespace gaussmethod {
+
+// Many augmented systems of the same size in one buffer. Systems are
+// grouped into packs of `lanes`, and inside a pack entry (i, j) of all its
+// systems lie next to each other, so one vector instruction works on a
+// whole pack. Padding systems of the last pack are identities.
+class SystemBatch {
+ public:
+  // systems per pack: one AVX-512 register of doubles
+  static constexpr int lanes = 8;
+
+  // count systems of n unknowns, all entries zero
+  SystemBatch(int count, int n);
+
+  int Count() const noexcept { return count_; }
+  int Size() const noexcept { return n_; }
+  int Packs() const noexcept { return (count_ + lanes - 1) / lanes; }
+
+  // entry (i, j) of system s; column Size() holds the free members
+  double& At(int s, int i, int j) noexcept { return data_[Index(s, i, j)]; }
+  double At(int s, int i, int j) const noexcept {
+    return data_[Index(s, i, j)];
+  }
+
+  // copies a Size() x (Size() + 1) matrix in as system s, or system s out
+  void Set(int s, const SimpleGraph<double>& matr);
+  SimpleGraph<double> Get(int s) const;
+
+  // first entry of a pack, laid out as described above
+  double* Pack(int pack) noexcept { return data_.data() + pack * PackSize(); }
+
+ private:
+  std::size_t PackSize() const noexcept {
+    return static_cast<std::size_t>(lanes) * n_ * (n_ + 1);
+  }
+  std::size_t Index(int s, int i, int j) const noexcept {
+    return (s / lanes) * PackSize() +
+           (static_cast<std::size_t>(i) * (n_ + 1) + j) * lanes + s % lanes;
+  }
+
+  int count_;
+  int n_;
+  std::vector<double, MatrixAllocator<double>> data_;
+};
+
+}  // namespace gaussmethod
+
+#endif  // GAUSS_BATCH_H_
@@ -1,170 +1,350 @@
 #include "gauss.h"
 
-#include <iostream>
-#include <mutex>
-#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#include "banded.h"
+#include "kernels.h"
+#include "lu.h"
+#include "parallel.h"
 
 namespace gaussmethod {
 
-int FindPivotRow(const SimpleGraph<double>& matrix, int row, int col) {
+// row in [row, rows) with the largest |value| in column col, or -1 if the
+// whole column is below EPS
+int FindPivotRow(MatrixView<const double> matrix, int row, int col) {
   int max_row = row;
   for (int i = row + 1; i != matrix.get_rows(); ++i) {
-    if (matrix[i][col] > matrix[max_row][col]) max_row = i;
+    if (std::abs(matrix[i][col]) > std::abs(matrix[max_row][col])) max_row = i;
   }
 
-  if (std::abs(matrix[max_row][col]) < Gauss::EPS)
-    throw std::runtime_error("continue");
+  if (std::abs(matrix[max_row][col]) < Gauss::EPS) return -1;
+
+  return max_row;
+}
+
+namespace {
+
+// largest |coefficient| of every row, the free member left out
+std::vector<double> RowScales(MatrixView<const double> matrix) {
+  const int m = matrix.get_cols() - 1;
+
+  std::vector<double> scale(matrix.get_rows(), 0);
+  for (int i = 0; i != matrix.get_rows(); ++i)
+    for (int j = 0; j != m; ++j)
+      scale[i] = std::max(scale[i], std::abs(matrix[i][j]));
+  return scale;
+}
+
+// as FindPivotRow, comparing |value| / scale of the row
+int FindScaledPivotRow(MatrixView<const double> matrix,
+                       const std::vector<double>& scale, int row, int col) {
+  int max_row = -1;
+  double max_ratio = 0;
+  for (int i = row; i != matrix.get_rows(); ++i) {
+    const double value = std::abs(matrix[i][col]);
+    if (value < Gauss::EPS) continue;
+
+    const double ratio = value / scale[i];
+    if (ratio > max_ratio) {
+      max_ratio = ratio;
+      max_row = i;
+    }
+  }
 
   return max_row;
 }
 
-int Gauss::Solve(SimpleGraph<double> matr, std::vector<double>& answer) {
+// position of the largest |value| in rows [row, rows) and coefficient
+// columns [col, m), or {-1, -1} if all of them are below EPS
+std::pair<int, int> FindCompletePivot(MatrixView<const double> matrix,
+                                      int row, int col) {
+  const int m = matrix.get_cols() - 1;
+
+  std::pair<int, int> pivot{-1, -1};
+  double max_value = Gauss::EPS;
+  for (int i = row; i != matrix.get_rows(); ++i)
+    for (int j = col; j != m; ++j)
+      if (std::abs(matrix[i][j]) >= max_value) {
+        max_value = std::abs(matrix[i][j]);
+        pivot = {i, j};
+      }
+
+  return pivot;
+}
+
+void SwapCols(MatrixView<double> matrix, int c1, int c2) {
+  if (c1 == c2) return;
+  for (int i = 0; i != matrix.get_rows(); ++i)
+    std::swap(matrix[i][c1], matrix[i][c2]);
+}
+
+// corrections MixedSolve tries before it factors in double, as in LAPACK
+const int max_refinements = 30;
+
+// makes zeros in column col of rows [first, last) with the pivot row
+void EliminateBelow(MatrixView<double> matr, int row, int col, int first,
+                    int last) {
+  const int m = matr.get_cols() - 1;
+
+  for (int i = first; i != last; ++i) {
+    auto coef = matr[i][col] / matr[row][col];
+    SubtractRow(&matr[i][col], &matr[row][col], coef, m - col + 1, true);
+  }
+}
+
+// makes zeros in column row of rows [first, last) above the (normalised) row
+void EliminateAbove(MatrixView<double> matr, int row, int first, int last) {
+  const int m = matr.get_cols() - 1;
+
+  for (int i = first; i != last; ++i) {
+    double K = matr[i][row] / matr[row][row];
+    SubtractRow(&matr[i][0], &matr[row][0], K, m + 1, false);
+  }
+}
+
+// Gauss-Jordan elimination shared by Solve and ParallelSolve. Every step
+// updates a range of independent rows through for_rows(first, last, func),
+// which decides whether func(first, last) runs inline or split over threads;
+// the arithmetic is the same either way.
+template <typename ForRows>
+int Eliminate(MatrixView<double> matr, std::vector<double>& answer,
+              Gauss::Pivoting pivoting, ForRows&& for_rows) {
   const int n = matr.get_rows();
   const int m = matr.get_cols() - 1;
 
+  std::vector<double> scale;
+  if (pivoting == Gauss::SCALED) scale = RowScales(matr);
+
+  // unknown of every column, changed by complete pivoting only
+  std::vector<int> unknown(m);
+  std::iota(unknown.begin(), unknown.end(), 0);
+
   // straight way
-  std::vector<int> where(m, -1);
-  for (int row = 0, col = 0; row < n && col < m; ++col) {
+  int rank = 0;
+  for (int col = 0; rank < n && col < m; ++col) {
+    const int row = rank;
     // pivot searching
-    try {
-      matr.SwapRows(row, FindPivotRow(matr, row, col));
-    } catch (...) {
-      continue;
+    int pivot_row = -1;
+    if (pivoting == Gauss::COMPLETE) {
+      auto pivot = FindCompletePivot(matr, row, col);
+      // nothing but zeros left: the remaining unknowns are free
+      if (pivot.first == -1) break;
+
+      SwapCols(matr, col, pivot.second);
+      std::swap(unknown[col], unknown[pivot.second]);
+      pivot_row = pivot.first;
+    } else if (pivoting == Gauss::SCALED) {
+      pivot_row = FindScaledPivotRow(matr, scale, row, col);
+      if (pivot_row != -1) std::swap(scale[row], scale[pivot_row]);
+    } else {
+      pivot_row = FindPivotRow(matr, row, col);
     }
-    where[col] = row;
+    if (pivot_row == -1) continue;
+
+    matr.SwapRows(row, pivot_row);
 
     // making triangle matrix
-    for (int i = row + 1; i != n; ++i) {
-      auto coef = matr[i][col] / matr[row][col];
-      for (int j = col; j <= m; ++j) {
-        matr[i][j] -= matr[row][j] * coef;
-        if (std::abs(matr[i][j]) < EPS) matr[i][j] = 0;
-      }
-    }
-    ++row;
+    for_rows(row + 1, n, [&](int first, int last) {
+      EliminateBelow(matr, row, col, first, last);
+    });
+    ++rank;
   }
 
-  // way back
+  // rows without a pivot have no coefficient left above EPS; a free
+  // member in one of them makes the system inconsistent
   answer.assign(m, 0);
-  for (int row = n - 1; row >= 0; --row) {
-    // check sum of coefs near 'x'
-    double sum = 0;
-    for (int col = m - 1; col >= 0; --col) sum += matr[row][col];
+  for (int row = rank; row != n; ++row) {
+    double max_coef = 0;
+    for (int col = 0; col != m; ++col)
+      max_coef = std::max(max_coef, std::abs(matr[row][col]));
 
-    if (std::abs(sum) < EPS && std::abs(matr[row][m]) > EPS) {
-      return NONE;
-    }
+    if (max_coef < Gauss::EPS && std::abs(matr[row][m]) > Gauss::EPS)
+      return Gauss::NONE;
+  }
+  if (rank < m) return Gauss::LOT;
 
+  // way back: every column has its pivot, on the diagonal
+  for (int row = m - 1; row >= 0; --row) {
     // works because matrix is triangle now
-    for (int col = m; col >= row /* 0 */; --col)
-      matr[row][col] /= matr[row][row];
+    for (int col = m; col >= row; --col) matr[row][col] /= matr[row][row];
 
     // making diagonal matrix
-    for (int i = row - 1; i >= 0; --i) {
-      double K = matr[i][row] / matr[row][row];
-      for (int j = m; j >= 0; --j) {
-        matr[i][j] = matr[i][j] - matr[row][j] * K;
-      }
-    }
+    for_rows(0, row, [&](int first, int last) {
+      EliminateAbove(matr, row, first, last);
+    });
   }
 
   // here we have diagonal main matrix, so answers are free members
+  for (int i = 0; i != m; ++i) {
+    answer[unknown[i]] = matr[i][m];
+  }
 
-  for (int i = 0; i != m; ++i)
-    if (where[i] == -1) return LOT;
+  return Gauss::ONE;
+}
 
-  for (int i = 0; i != n; ++i) {
-    answer[i] = matr[i][n];
-  }
+}  // namespace
 
-  return ONE;
+int Gauss::Solve(SimpleGraph<double> matr, std::vector<double>& answer,
+                 Pivoting pivoting) {
+  return SolveInPlace(matr, answer, pivoting);
 }
 
-struct StraightWay {
-  SimpleGraph<double>& matr_ref;
-  std::vector<int>& where_ref;
-  std::mutex& matr_mtx_ref;
+int Gauss::SolveInPlace(MatrixView<double> matr, std::vector<double>& answer,
+                        Pivoting pivoting) {
+  return Eliminate(matr, answer, pivoting,
+                   [](int first, int last, auto&& func) { func(first, last); });
+}
 
-  void operator()(int n, int m) {
-    matr_mtx_ref.lock();
-    for (int row = 0, col = 0; row < n && col < m; ++col) {
-      try {
-        matr_ref.SwapRows(row, FindPivotRow(matr_ref, row, col));
-      } catch (...) {
-        continue;
-      }
-      where_ref[col] = row;
+int Gauss::ParallelSolve(SimpleGraph<double> matr, std::vector<double>& answer,
+                         Pivoting pivoting) {
+  return ParallelSolveInPlace(matr, answer, pivoting);
+}
 
-      for (int i = row + 1; i != n; ++i) {
-        double coef = matr_ref[i][col] / matr_ref[row][col];
-        for (int j = 0; j <= m; ++j) {
-          matr_ref[i][j] -= matr_ref[row][j] * coef;
+int Gauss::ParallelSolve(SimpleGraph<double> matr, std::vector<double>& answer,
+                         ThreadPool& pool, Pivoting pivoting) {
+  return ParallelSolveInPlace(matr, answer, pool, pivoting);
+}
 
-          if (std::abs(matr_ref[i][j]) < Gauss::EPS) matr_ref[i][j] = 0;
-        }
-      }
-      ++row;
-    }
-    matr_mtx_ref.unlock();
-  }
-};
-
-struct BackwardWay {
-  SimpleGraph<double>& matr_ref;
-  std::mutex& matr_mtx_ref;
-
-  void operator()(int n, int m) {
-    matr_mtx_ref.lock();
-    for (int row = n - 1; row >= 0; --row) {
-      // check sum of coefs near 'x'
-      double sum = 0;
-      for (int col = m - 1; col >= 0; --col) sum += matr_ref[row][col];
-
-      if (std::abs(sum) < Gauss::EPS &&
-          std::abs(matr_ref[row][m]) > Gauss::EPS) {
-        /* return NONE; */
-      }
+int Gauss::ParallelSolveInPlace(MatrixView<double> matr,
+                                std::vector<double>& answer,
+                                Pivoting pivoting) {
+  return ParallelSolveInPlace(matr, answer, DefaultPool(), pivoting);
+}
 
-      for (int col = m; col >= row /* 0 */; --col)
-        matr_ref[row][col] /= matr_ref[row][row];
+int Gauss::ParallelSolveInPlace(MatrixView<double> matr,
+                                std::vector<double>& answer, ThreadPool& pool,
+                                Pivoting pivoting) {
+  const long long width = matr.get_cols();
 
-      for (int i = row - 1; i >= 0; --i) {
-        double K = matr_ref[i][row] / matr_ref[row][row];
-        for (int j = m; j >= 0; --j) {
-          matr_ref[i][j] = matr_ref[i][j] - matr_ref[row][j] * K;
-        }
-      }
+  auto for_rows = [&](int first, int last, auto&& func) {
+    if (pool.Size() == 1 || (last - first) * width < parallel_grain) {
+      func(first, last);
+      return;
     }
-    matr_mtx_ref.unlock();
-  }
-};
 
-int Gauss::ParallelSolve(SimpleGraph<double> matr,
-                         std::vector<double>& answer) {
+    pool.ParallelFor(last - first, [&](int, int begin, int end) {
+      func(first + begin, first + end);
+    });
+  };
+  return Eliminate(matr, answer, pivoting, for_rows);
+}
+
+int Gauss::MixedSolve(const SimpleGraph<double>& matr,
+                      std::vector<double>& answer) {
+  Refinement refinement;
+  return MixedSolve(matr, answer, refinement);
+}
+
+int Gauss::MixedSolve(const SimpleGraph<double>& matr,
+                      std::vector<double>& answer, Refinement& refinement) {
+  refinement = Refinement{};
   const int n = matr.get_rows();
-  const int m = matr.get_cols() - 1;
+  if (matr.get_cols() != n + 1) return Solve(matr, answer);
 
-  std::mutex matr_mtx;
+  std::vector<double> b(n);
+  double a_norm = 0;
+  for (int i = 0; i != n; ++i) {
+    double sum = 0;
+    for (int j = 0; j != n; ++j) sum += std::abs(matr[i][j]);
+    a_norm = std::max(a_norm, sum);
+    b[i] = matr[i][n];
+  }
 
-  std::vector<int> where(m, -1);
+  // r = b - A * x, returns max |r[i]|
+  std::vector<double> r(n);
+  auto residual = [&](const std::vector<double>& x) {
+    double norm = 0;
+    for (int i = 0; i != n; ++i) {
+      double sum = b[i];
+      for (int j = 0; j != n; ++j) sum -= matr[i][j] * x[j];
+      r[i] = sum;
+      norm = std::max(norm, std::abs(sum));
+    }
+    return norm;
+  };
+
+  // the residual a double solve leaves, as LAPACK dsgesv takes it
+  auto accurate = [&](const std::vector<double>& x, double r_norm) {
+    double x_norm = 0;
+    for (double v : x) x_norm = std::max(x_norm, std::abs(v));
+    return r_norm <= x_norm * a_norm *
+                         std::numeric_limits<double>::epsilon() *
+                         std::sqrt(static_cast<double>(n));
+  };
+
+  // double factors, or Solve to tell NONE from LOT for a singular matrix
+  auto fall_back = [&] {
+    refinement.fell_back = true;
+    LU exact(matr);
+    if (exact.Singular()) {
+      const int result = Solve(matr, answer);
+      refinement.residual = result == ONE ? residual(answer) : 0;
+      return result;
+    }
+    exact.Solve(b, answer);
+    refinement.residual = residual(answer);
+    return static_cast<int>(ONE);
+  };
+
+  FloatLU lu(matr);
+  if (lu.Singular()) return fall_back();
+
+  lu.Solve(b, answer);
+  refinement.residual = residual(answer);
+
+  // corrections stop once the answer is accurate; if they stop helping
+  // first, the float factors are too coarse for the matrix
+  std::vector<double> correction;
+  while (!accurate(answer, refinement.residual)) {
+    std::vector<double> next = answer;
+    double next_residual = std::numeric_limits<double>::infinity();
+    if (refinement.steps != max_refinements) {
+      lu.Solve(r, correction);
+      for (int i = 0; i != n; ++i) next[i] += correction[i];
+      next_residual = residual(next);
+    }
 
-  StraightWay strw{matr, where, matr_mtx};
-  BackwardWay bckw{matr, matr_mtx};
+    if (!(next_residual < refinement.residual)) return fall_back();
 
-  std::thread straight_way(strw, n, m);
-  std::thread backward_way(bckw, n, m);
+    answer.swap(next);
+    refinement.residual = next_residual;
+    ++refinement.steps;
+  }
 
-  straight_way.join();
-  backward_way.join();
+  return ONE;
+}
 
-  for (int i = 0; i != m; ++i)
-    if (where[i] == -1) return LOT;
+int Gauss::BandedSolve(const SimpleGraph<double>& matr,
+                       std::vector<double>& answer, int lower, int upper) {
+  const int n = matr.get_rows();
+  if (matr.get_cols() != n + 1) return Solve(matr, answer);
 
-  answer.assign(n, 0);
-  for (int i = 0; i != n; ++i) {
-    answer[i] = matr[i][n];
-  }
+  BandLU lu;
+  lu.Factor(matr, lower, upper);
+  if (lu.Singular()) return Solve(matr, answer);
+
+  std::vector<double> b(n);
+  for (int i = 0; i != n; ++i) b[i] = matr[i][n];
+  lu.Solve(b, answer);
+  return ONE;
+}
+
+int Gauss::BandedSolve(const CsrMatrix& matr, const std::vector<double>& b,
+                       std::vector<double>& answer, int lower, int upper) {
+  BandLU lu;
+  lu.Factor(matr, lower, upper);
+  lu.Solve(b, answer);
+  return ONE;
+}
 
+int Gauss::SparseSolve(const CsrMatrix& matr, const std::vector<double>& b,
+                       std::vector<double>& answer) {
+  SparseLU lu(matr);
+  lu.Solve(b, answer);
   return ONE;
 }
 
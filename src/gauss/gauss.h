@@ -3,7 +3,11 @@
 
 #include <vector>
 
+#include "../matrixview.h"
 #include "../simplegraph.h"
+#include "../threadpool.h"
+#include "batch.h"
+#include "sparse.h"
 
 namespace gaussmethod {
 
@@ -12,9 +16,80 @@ class Gauss {
   enum { NONE = 0, ONE, LOT };
   constexpr static double EPS = 1e-6;
 
-  static int Solve(SimpleGraph<double> matr, std::vector<double>& answer);
+  // How the pivot of every column is chosen:
+  // PARTIAL - the largest |value| of the column, the cheapest;
+  // SCALED - the largest |value| relative to the largest coefficient of its
+  //   row, for rows of very different magnitude;
+  // COMPLETE - the largest |value| left in the whole matrix, columns are
+  //   swapped too; the most stable and the slowest.
+  enum Pivoting { PARTIAL = 0, SCALED, COMPLETE };
+
+  // what MixedSolve did after the single precision solve
+  struct Refinement {
+    int steps{0};            // corrections applied
+    double residual{0};      // max |b - A * answer| at the end
+    bool fell_back{false};   // float factors were too coarse, double used
+  };
+
+  static int Solve(SimpleGraph<double> matr, std::vector<double>& answer,
+                   Pivoting pivoting = PARTIAL);
+  // Same elimination as Solve, with the row updates of every step split
+  // over the worker threads. The pool is kept between calls; without one a
+  // pool of hardware_concurrency threads shared by all callers is used.
   static int ParallelSolve(SimpleGraph<double> matr,
-                           std::vector<double>& answer);
+                           std::vector<double>& answer,
+                           Pivoting pivoting = PARTIAL);
+  static int ParallelSolve(SimpleGraph<double> matr,
+                           std::vector<double>& answer, ThreadPool& pool,
+                           Pivoting pivoting = PARTIAL);
+
+  // Solve and ParallelSolve on the caller's storage: matr, which can be a
+  // block of a bigger matrix, is eliminated in place instead of copied, and
+  // answer keeps its capacity, so repeated solves do not allocate.
+  static int SolveInPlace(MatrixView<double> matr, std::vector<double>& answer,
+                          Pivoting pivoting = PARTIAL);
+  static int ParallelSolveInPlace(MatrixView<double> matr,
+                                  std::vector<double>& answer,
+                                  Pivoting pivoting = PARTIAL);
+  static int ParallelSolveInPlace(MatrixView<double> matr,
+                                  std::vector<double>& answer,
+                                  ThreadPool& pool,
+                                  Pivoting pivoting = PARTIAL);
+
+  // Solves every system of a batch, a pack of them per vector instruction
+  // and the packs split over the threads; the batch is eliminated in place.
+  // answers gets the unknowns of system s at [s * n, (s + 1) * n) and
+  // statuses its NONE, ONE or LOT, as Solve would give. Neither allocates
+  // when it already has the size of the batch.
+  static void BatchSolve(SystemBatch& batch, std::vector<double>& answers,
+                         std::vector<int>& statuses);
+  static void BatchSolve(SystemBatch& batch, std::vector<double>& answers,
+                         std::vector<int>& statuses, ThreadPool& pool);
+
+  // Factors in float, at twice the vector width and half the memory traffic,
+  // then corrects the answer with residuals computed in double until it is
+  // as accurate as a double solve. Singular systems go through Solve.
+  static int MixedSolve(const SimpleGraph<double>& matr,
+                        std::vector<double>& answer);
+  static int MixedSolve(const SimpleGraph<double>& matr,
+                        std::vector<double>& answer, Refinement& refinement);
+
+  // Systems whose coefficients lie within lower diagonals below and upper
+  // above the main one, in O(n * b^2) through BandLU. Negative bandwidths
+  // are detected. A singular matrix goes through Solve to tell NONE from
+  // LOT.
+  static int BandedSolve(const SimpleGraph<double>& matr,
+                         std::vector<double>& answer, int lower = -1,
+                         int upper = -1);
+  // The same for a sparse matrix and its right-hand side, for systems too
+  // big to be held densely; a singular one throws std::runtime_error.
+  static int BandedSolve(const CsrMatrix& matr, const std::vector<double>& b,
+                         std::vector<double>& answer, int lower = -1,
+                         int upper = -1);
+  // matr * answer = b through SparseLU, with a fill-reducing ordering; a
+  // singular matrix throws std::runtime_error.
+  static int SparseSolve(const CsrMatrix& matr, const std::vector<double>& b,
+                         std::vector<double>& answer);
 };
 
 }  // namespace gaussmethod
@@ -0,0 +1,315 @@
+#include "iterative.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "gauss.h"
+#include "parallel.h"
+
+namespace gaussmethod {
+
+namespace {
+
+double Dot(const std::vector<double>& a, const std::vector<double>& b) {
+  double sum = 0;
+  for (std::size_t i = 0; i != a.size(); ++i) sum += a[i] * b[i];
+  return sum;
+}
+
+double Norm(const std::vector<double>& a) { return std::sqrt(Dot(a, a)); }
+
+// coefficients of an augmented matrix as a CsrMatrix, free members as b
+void SplitAugmented(const SimpleGraph<double>& matr, CsrMatrix& a,
+                    std::vector<double>& b) {
+  const int n = matr.get_rows();
+  if (matr.get_cols() != n + 1)
+    throw std::invalid_argument("Iterative solvers need a square system");
+
+  a = CsrMatrix::FromDense(matr, n);
+  b.resize(n);
+  for (int i = 0; i != n; ++i) b[i] = matr[i][n];
+}
+
+// z = M^-1 * r for the preconditioner M of a matrix
+class ApproximateInverse {
+ public:
+  ApproximateInverse(const CsrMatrix& a, IterativeSolver::Preconditioner kind)
+      : kind_{kind} {
+    if (kind_ == IterativeSolver::JACOBI) {
+      inverse_diagonal_.assign(a.rows, 1);
+      for (int i = 0; i != a.rows; ++i)
+        for (int k = a.row_start[i]; k != a.row_start[i + 1]; ++k)
+          if (a.col_index[k] == i && a.values[k] != 0)
+            inverse_diagonal_[i] = 1 / a.values[k];
+    } else if (kind_ == IterativeSolver::ILU0) {
+      FactorIlu0(a);
+    }
+  }
+
+  void Apply(const std::vector<double>& r, std::vector<double>& z) const {
+    const int n = static_cast<int>(r.size());
+    z.resize(n);
+
+    switch (kind_) {
+      case IterativeSolver::NO_PRECONDITIONER:
+        z = r;
+        break;
+      case IterativeSolver::JACOBI:
+        for (int i = 0; i != n; ++i) z[i] = r[i] * inverse_diagonal_[i];
+        break;
+      case IterativeSolver::ILU0:
+        for (int i = 0; i != n; ++i) {
+          double sum = r[i];
+          for (int k = ilu_.row_start[i]; k != diagonal_[i]; ++k)
+            sum -= ilu_.values[k] * z[ilu_.col_index[k]];
+          z[i] = sum;
+        }
+        for (int i = n - 1; i >= 0; --i) {
+          double sum = z[i];
+          for (int k = diagonal_[i] + 1; k != ilu_.row_start[i + 1]; ++k)
+            sum -= ilu_.values[k] * z[ilu_.col_index[k]];
+          z[i] = sum / ilu_.values[diagonal_[i]];
+        }
+        break;
+    }
+  }
+
+ private:
+  // L * U restricted to the pattern of a, in place of a copy of a with
+  // sorted rows; diagonal_[i] is the position of the entry (i, i)
+  void FactorIlu0(const CsrMatrix& a) {
+    const int n = a.rows;
+
+    ilu_.rows = ilu_.cols = n;
+    std::vector<std::pair<int, double>> row;
+    for (int i = 0; i != n; ++i) {
+      row.clear();
+      for (int k = a.row_start[i]; k != a.row_start[i + 1]; ++k)
+        row.push_back({a.col_index[k], a.values[k]});
+      std::sort(row.begin(), row.end(),
+                [](const auto& x, const auto& y) { return x.first < y.first; });
+      for (const auto& [col, value] : row) {
+        if (ilu_.NonZeros() > ilu_.row_start[i] && ilu_.col_index.back() == col)
+          ilu_.values.back() += value;
+        else {
+          ilu_.col_index.push_back(col);
+          ilu_.values.push_back(value);
+        }
+      }
+      ilu_.row_start.push_back(ilu_.NonZeros());
+    }
+
+    diagonal_.assign(n, -1);
+    for (int i = 0; i != n; ++i)
+      for (int k = ilu_.row_start[i]; k != ilu_.row_start[i + 1]; ++k)
+        if (ilu_.col_index[k] == i) diagonal_[i] = k;
+    if (std::count(diagonal_.begin(), diagonal_.end(), -1))
+      throw std::invalid_argument("ILU(0) needs every diagonal entry");
+
+    std::vector<int> where(n, -1);
+    for (int i = 0; i != n; ++i) {
+      for (int k = ilu_.row_start[i]; k != ilu_.row_start[i + 1]; ++k)
+        where[ilu_.col_index[k]] = k;
+
+      for (int k = ilu_.row_start[i]; k != diagonal_[i]; ++k) {
+        const int j = ilu_.col_index[k];
+        const double l = ilu_.values[k] /= ilu_.values[diagonal_[j]];
+        for (int q = diagonal_[j] + 1; q != ilu_.row_start[j + 1]; ++q)
+          if (where[ilu_.col_index[q]] != -1)
+            ilu_.values[where[ilu_.col_index[q]]] -= l * ilu_.values[q];
+      }
+
+      for (int k = ilu_.row_start[i]; k != ilu_.row_start[i + 1]; ++k)
+        where[ilu_.col_index[k]] = -1;
+
+      if (std::abs(ilu_.values[diagonal_[i]]) < Gauss::EPS)
+        throw std::runtime_error("ILU(0) met a zero pivot");
+    }
+  }
+
+  IterativeSolver::Preconditioner kind_;
+  std::vector<double> inverse_diagonal_;
+  CsrMatrix ilu_;
+  std::vector<int> diagonal_;
+};
+
+}  // namespace
+
+int IterativeSolver::CgSolve(const SimpleGraph<double>& matr,
+                             std::vector<double>& answer) {
+  CsrMatrix a;
+  std::vector<double> b;
+  SplitAugmented(matr, a, b);
+  return CgSolve(a, b, answer);
+}
+
+int IterativeSolver::GmresSolve(const SimpleGraph<double>& matr,
+                                std::vector<double>& answer) {
+  CsrMatrix a;
+  std::vector<double> b;
+  SplitAugmented(matr, a, b);
+  return GmresSolve(a, b, answer);
+}
+
+// preconditioned conjugate gradients
+int IterativeSolver::CgSolve(const CsrMatrix& a, const std::vector<double>& b,
+                             std::vector<double>& answer) {
+  Check(a, b);
+  const int n = a.rows;
+
+  iterations_ = 0;
+  residual_ = 0;
+  answer.assign(n, 0);
+
+  const double b_norm = Norm(b);
+  if (b_norm == 0) return Gauss::ONE;
+
+  ApproximateInverse inverse(a, preconditioner_);
+
+  std::vector<double> r = b, z, p, q(n);
+  inverse.Apply(r, z);
+  p = z;
+  double rz = Dot(r, z);
+  residual_ = 1;
+
+  while (iterations_ < max_iterations_) {
+    ++iterations_;
+    Multiply(a, p, q);
+    const double pq = Dot(p, q);
+    if (pq <= 0)
+      throw std::runtime_error("CG needs a positive definite matrix");
+
+    const double alpha = rz / pq;
+    for (int i = 0; i != n; ++i) {
+      answer[i] += alpha * p[i];
+      r[i] -= alpha * q[i];
+    }
+
+    residual_ = Norm(r) / b_norm;
+    if (residual_ < tolerance_) return Gauss::ONE;
+
+    inverse.Apply(r, z);
+    const double rz_next = Dot(r, z);
+    const double beta = rz_next / rz;
+    rz = rz_next;
+    for (int i = 0; i != n; ++i) p[i] = z[i] + beta * p[i];
+  }
+
+  return NOT_CONVERGED;
+}
+
+// GMRES(restart) preconditioned from the right, so the residual it
+// minimises is the one of the system itself
+int IterativeSolver::GmresSolve(const CsrMatrix& a,
+                                const std::vector<double>& b,
+                                std::vector<double>& answer) {
+  Check(a, b);
+  const int n = a.rows;
+  const int m = restart_;
+
+  iterations_ = 0;
+  residual_ = 0;
+  answer.assign(n, 0);
+
+  const double b_norm = Norm(b);
+  if (b_norm == 0) return Gauss::ONE;
+
+  ApproximateInverse inverse(a, preconditioner_);
+
+  std::vector<std::vector<double>> v(m + 1, std::vector<double>(n));
+  std::vector<std::vector<double>> h(m + 1, std::vector<double>(m));
+  std::vector<double> cs(m), sn(m), g(m + 1), y(m);
+  std::vector<double> r(n), z, w(n);
+
+  while (true) {
+    // true residual of the current answer
+    Multiply(a, answer, r);
+    for (int i = 0; i != n; ++i) r[i] = b[i] - r[i];
+    const double beta = Norm(r);
+    residual_ = beta / b_norm;
+    if (residual_ < tolerance_) return Gauss::ONE;
+    if (iterations_ >= max_iterations_) return NOT_CONVERGED;
+
+    for (int i = 0; i != n; ++i) v[0][i] = r[i] / beta;
+    std::fill(g.begin(), g.end(), 0);
+    g[0] = beta;
+
+    int k = 0;  // Krylov vectors of this cycle
+    while (k < m && iterations_ < max_iterations_) {
+      ++iterations_;
+      inverse.Apply(v[k], z);
+      Multiply(a, z, w);
+
+      // modified Gram-Schmidt
+      for (int i = 0; i <= k; ++i) {
+        h[i][k] = Dot(w, v[i]);
+        for (int j = 0; j != n; ++j) w[j] -= h[i][k] * v[i][j];
+      }
+      const double next = Norm(w);
+      if (next != 0)
+        for (int j = 0; j != n; ++j) v[k + 1][j] = w[j] / next;
+
+      // keep the Hessenberg matrix triangular with Givens rotations
+      for (int i = 0; i != k; ++i) {
+        const double t = cs[i] * h[i][k] + sn[i] * h[i + 1][k];
+        h[i + 1][k] = -sn[i] * h[i][k] + cs[i] * h[i + 1][k];
+        h[i][k] = t;
+      }
+      const double d = std::hypot(h[k][k], next);
+      cs[k] = d == 0 ? 1 : h[k][k] / d;
+      sn[k] = d == 0 ? 0 : next / d;
+      h[k][k] = d;
+      g[k + 1] = -sn[k] * g[k];
+      g[k] *= cs[k];
+      ++k;
+
+      if (next == 0 || std::abs(g[k]) / b_norm < tolerance_) break;
+    }
+
+    // answer += M^-1 * V * y, where H * y = g
+    for (int i = k - 1; i >= 0; --i) {
+      double sum = g[i];
+      for (int j = i + 1; j != k; ++j) sum -= h[i][j] * y[j];
+      y[i] = h[i][i] == 0 ? 0 : sum / h[i][i];
+    }
+    std::fill(w.begin(), w.end(), 0);
+    for (int i = 0; i != k; ++i)
+      for (int j = 0; j != n; ++j) w[j] += y[i] * v[i][j];
+    inverse.Apply(w, z);
+    for (int j = 0; j != n; ++j) answer[j] += z[j];
+  }
+}
+
+void IterativeSolver::Check(const CsrMatrix& a,
+                            const std::vector<double>& b) const {
+  a.Check();
+  if (a.rows != a.cols || static_cast<int>(b.size()) != a.rows)
+    throw std::invalid_argument("Iterative solvers need a square system");
+  if (!(tolerance_ > 0) || max_iterations_ < 1 || restart_ < 1)
+    throw std::invalid_argument("Invalid iterative solver settings");
+}
+
+void IterativeSolver::Multiply(const CsrMatrix& a,
+                               const std::vector<double>& x,
+                               std::vector<double>& y) {
+  auto rows = [&](int first, int last) {
+    for (int i = first; i != last; ++i) {
+      double sum = 0;
+      for (int k = a.row_start[i]; k != a.row_start[i + 1]; ++k)
+        sum += a.values[k] * x[a.col_index[k]];
+      y[i] = sum;
+    }
+  };
+
+  if (pool_->Size() == 1 || a.NonZeros() < parallel_grain) {
+    rows(0, a.rows);
+    return;
+  }
+  pool_->ParallelFor(a.rows, [&](int, int first, int last) {
+    rows(first, last);
+  });
+}
+
+}  // namespace gaussmethod
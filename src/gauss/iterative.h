@@ -0,0 +1,95 @@
+#ifndef GAUSS_ITERATIVE_H_
+#define GAUSS_ITERATIVE_H_
+
+#include <memory>
+#include <vector>
+
+#include "../simplegraph.h"
+#include "../threadpool.h"
+#include "gauss.h"
+#include "parallel.h"
+#include "sparse.h"
+
+namespace gaussmethod {
+
+// Krylov solvers for large systems where elimination is too slow: CG for
+// symmetric positive definite matrices, restarted GMRES for any other.
+// Both take the augmented matrix of Gauss::Solve, or a CsrMatrix and its
+// right-hand side, start from zero and return Gauss::ONE once
+// |b - A * answer| / |b| is below the tolerance, or NOT_CONVERGED if the
+// iteration cap comes first; answer then keeps the last iterate. CG throws
+// std::runtime_error if it finds the matrix not positive definite. Neither
+// tells systems without solutions or with many, that is for Gauss::Solve.
+// Matrix-vector products are split over the worker threads.
+class IterativeSolver {
+ public:
+  // status next to Gauss::NONE, ONE and LOT
+  enum { NOT_CONVERGED = Gauss::LOT + 1 };
+
+  // M in the M^-1 * A the iterations work with
+  enum Preconditioner { NO_PRECONDITIONER = 0, JACOBI, ILU0 };
+
+  // threads < 1 means the default pool, one worker per hardware thread
+  explicit IterativeSolver(int threads = 0)
+      : own_pool_{threads < 1 ? nullptr
+                              : std::make_unique<ThreadPool>(threads)},
+        pool_{own_pool_ ? own_pool_.get() : &DefaultPool()},
+        tolerance_{1e-10},
+        max_iterations_{1000},
+        restart_{30},
+        preconditioner_{JACOBI},
+        iterations_{0},
+        residual_{0} {}
+
+  int CgSolve(const SimpleGraph<double>& matr, std::vector<double>& answer);
+  int CgSolve(const CsrMatrix& a, const std::vector<double>& b,
+              std::vector<double>& answer);
+
+  int GmresSolve(const SimpleGraph<double>& matr,
+                 std::vector<double>& answer);
+  int GmresSolve(const CsrMatrix& a, const std::vector<double>& b,
+                 std::vector<double>& answer);
+
+  int get_threads() const noexcept { return pool_->Size(); }
+
+  // relative residual a solve stops at
+  double get_tolerance() const noexcept { return tolerance_; }
+  void set_tolerance(double tolerance) noexcept { tolerance_ = tolerance; }
+
+  // matrix-vector products a solve may spend
+  int get_max_iterations() const noexcept { return max_iterations_; }
+  void set_max_iterations(int n) noexcept { max_iterations_ = n; }
+
+  // Krylov vectors GMRES keeps before it restarts
+  int get_restart() const noexcept { return restart_; }
+  void set_restart(int n) noexcept { restart_ = n; }
+
+  // ILU(0) needs every diagonal entry present and pivots that do not
+  // vanish; it is the strongest of the three but applies sequentially
+  Preconditioner get_preconditioner() const noexcept { return preconditioner_; }
+  void set_preconditioner(Preconditioner p) noexcept { preconditioner_ = p; }
+
+  // of the last solve
+  int get_iterations() const noexcept { return iterations_; }
+  double get_residual() const noexcept { return residual_; }
+
+ private:
+  void Check(const CsrMatrix& a, const std::vector<double>& b) const;
+  // y = A * x
+  void Multiply(const CsrMatrix& a, const std::vector<double>& x,
+                std::vector<double>& y);
+
+  std::unique_ptr<ThreadPool> own_pool_;
+  ThreadPool* pool_;  // own_pool_ or the default one
+  double tolerance_;
+  int max_iterations_;
+  int restart_;
+  Preconditioner preconditioner_;
+
+  int iterations_;
+  double residual_;
+};
+
+}  // namespace gaussmethod
+
+#endif  // GAUSS_ITERATIVE_H_
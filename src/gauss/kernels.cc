@@ -0,0 +1,154 @@
+#include "kernels.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "../simd.h"
+#include "gauss.h"
+
+namespace gaussmethod {
+
+namespace {
+
+template <typename T>
+void SubtractRowScalar(T* x, const T* p, T coef, int count, bool clamp) {
+  const T eps = static_cast<T>(Gauss::EPS);
+  for (int j = 0; j < count; ++j) {
+    x[j] -= p[j] * coef;
+    if (clamp && std::abs(x[j]) < eps) x[j] = 0;
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2"))) void SubtractRowAvx2(double* x,
+                                                     const double* p,
+                                                     double coef, int count,
+                                                     bool clamp) {
+  const __m256d c = _mm256_set1_pd(coef);
+  const __m256d eps = _mm256_set1_pd(Gauss::EPS);
+  const __m256d sign = _mm256_set1_pd(-0.0);
+
+  int j = 0;
+  for (; j + 4 <= count; j += 4) {
+    __m256d v = _mm256_sub_pd(_mm256_loadu_pd(x + j),
+                              _mm256_mul_pd(_mm256_loadu_pd(p + j), c));
+    if (clamp) {
+      __m256d small =
+          _mm256_cmp_pd(_mm256_andnot_pd(sign, v), eps, _CMP_LT_OQ);
+      v = _mm256_andnot_pd(small, v);
+    }
+    _mm256_storeu_pd(x + j, v);
+  }
+
+  SubtractRowScalar(x + j, p + j, coef, count - j, clamp);
+}
+
+__attribute__((target("avx512f"))) void SubtractRowAvx512(double* x,
+                                                          const double* p,
+                                                          double coef,
+                                                          int count,
+                                                          bool clamp) {
+  const __m512d c = _mm512_set1_pd(coef);
+  const __m512d eps = _mm512_set1_pd(Gauss::EPS);
+
+  // avx512f has fma, and the compiler would fuse a plain mul and sub into
+  // it; the explicitly rounded product keeps them apart. The tail goes
+  // through masked loads for the same reason.
+  for (int j = 0; j < count; j += 8) {
+    const __mmask8 mask =
+        count - j >= 8 ? 0xff : static_cast<__mmask8>((1u << (count - j)) - 1);
+    const int rounding = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+    const __m512d product = _mm512_maskz_mul_round_pd(
+        mask, _mm512_maskz_loadu_pd(mask, p + j), c, rounding);
+    __m512d v = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, x + j), product);
+    if (clamp) {
+      __mmask8 small = _mm512_cmp_pd_mask(_mm512_abs_pd(v), eps, _CMP_LT_OQ);
+      v = _mm512_maskz_mov_pd(static_cast<__mmask8>(~small), v);
+    }
+    _mm512_mask_storeu_pd(x + j, mask, v);
+  }
+}
+
+__attribute__((target("avx2"))) void SubtractRowAvx2(float* x, const float* p,
+                                                     float coef, int count,
+                                                     bool clamp) {
+  const __m256 c = _mm256_set1_ps(coef);
+  const __m256 eps = _mm256_set1_ps(static_cast<float>(Gauss::EPS));
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+
+  int j = 0;
+  for (; j + 8 <= count; j += 8) {
+    __m256 v = _mm256_sub_ps(_mm256_loadu_ps(x + j),
+                             _mm256_mul_ps(_mm256_loadu_ps(p + j), c));
+    if (clamp) {
+      __m256 small = _mm256_cmp_ps(_mm256_andnot_ps(sign, v), eps, _CMP_LT_OQ);
+      v = _mm256_andnot_ps(small, v);
+    }
+    _mm256_storeu_ps(x + j, v);
+  }
+
+  SubtractRowScalar(x + j, p + j, coef, count - j, clamp);
+}
+
+__attribute__((target("avx512f"))) void SubtractRowAvx512(float* x,
+                                                          const float* p,
+                                                          float coef,
+                                                          int count,
+                                                          bool clamp) {
+  const __m512 c = _mm512_set1_ps(coef);
+  const __m512 eps = _mm512_set1_ps(static_cast<float>(Gauss::EPS));
+
+  for (int j = 0; j < count; j += 16) {
+    const int rest = count - j;
+    const __mmask16 mask =
+        rest >= 16 ? 0xffff : static_cast<__mmask16>((1u << rest) - 1);
+    const int rounding = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+    const __m512 product = _mm512_maskz_mul_round_ps(
+        mask, _mm512_maskz_loadu_ps(mask, p + j), c, rounding);
+    __m512 v = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, x + j), product);
+    if (clamp) {
+      __mmask16 small = _mm512_cmp_ps_mask(_mm512_abs_ps(v), eps, _CMP_LT_OQ);
+      v = _mm512_maskz_mov_ps(static_cast<__mmask16>(~small), v);
+    }
+    _mm512_mask_storeu_ps(x + j, mask, v);
+  }
+}
+
+#endif
+
+template <typename T>
+using SubtractRowKernel = void (*)(T*, const T*, T, int, bool);
+
+template <typename T>
+SubtractRowKernel<T> ChooseSubtractRow() {
+#if defined(__x86_64__) || defined(__i386__)
+  switch (DetectSimd()) {
+    case SIMD_AVX512:
+      return SubtractRowAvx512;
+    case SIMD_AVX2:
+      return SubtractRowAvx2;
+    default:
+      break;
+  }
+#endif
+  return SubtractRowScalar<T>;
+}
+
+}  // namespace
+
+void SubtractRow(double* x, const double* p, double coef, int count,
+                 bool clamp) {
+  static const SubtractRowKernel<double> kernel = ChooseSubtractRow<double>();
+  kernel(x, p, coef, count, clamp);
+}
+
+void SubtractRow(float* x, const float* p, float coef, int count, bool clamp) {
+  static const SubtractRowKernel<float> kernel = ChooseSubtractRow<float>();
+  kernel(x, p, coef, count, clamp);
+}
+
+}  // namespace gaussmethod
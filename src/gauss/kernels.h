@@ -0,0 +1,18 @@
+#ifndef GAUSS_KERNELS_H_
+#define GAUSS_KERNELS_H_
+
+namespace gaussmethod {
+
+// x[j] -= p[j] * coef for j in [0, count). With clamp, results smaller than
+// Gauss::EPS in magnitude become exact zeros, as elimination needs. Uses the
+// widest vector unit of the CPU; every variant multiplies and subtracts
+// separately, so with the default (non-fma) flags all of them give the same
+// bits as the scalar loop.
+void SubtractRow(double* x, const double* p, double coef, int count,
+                 bool clamp);
+// twice the lanes, for factors kept in single precision
+void SubtractRow(float* x, const float* p, float coef, int count, bool clamp);
+
+}  // namespace gaussmethod
+
+#endif  // GAUSS_KERNELS_H_
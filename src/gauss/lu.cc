@@ -0,0 +1,187 @@
+#include "lu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "gauss.h"
+#include "kernels.h"
+#include "parallel.h"
+
+namespace gaussmethod {
+
+namespace {
+
+const int block_size = 64;    // columns of one panel
+const int tile_width = 256;   // columns of U kept in cache by an update
+
+}  // namespace
+
+template <typename T>
+void BasicLU<T>::Factor(const SimpleGraph<double>& a) {
+  Factor(a, nullptr);
+}
+
+template <typename T>
+void BasicLU<T>::Factor(const SimpleGraph<double>& a, ThreadPool& pool) {
+  Factor(a, &pool);
+}
+
+// Right-looking blocked LU: factor a panel of block_size columns, solve for
+// the block row of U right of it, then update the trailing matrix with one
+// matrix product, tile by tile.
+template <typename T>
+void BasicLU<T>::Factor(const SimpleGraph<double>& a, ThreadPool* pool) {
+  const int n = a.get_rows();
+  if (n == 0 || a.get_cols() < n)
+    throw std::invalid_argument("LU needs a square (or augmented) matrix");
+
+  n_ = n;
+  stride_ = MatrixAllocator<T>::RowStride(n);
+  singular_ = false;
+  lu_.resize(n * stride_);
+  pivots_.resize(n);
+
+  for (int i = 0; i != n; ++i)
+    for (int j = 0; j != n; ++j) Row(i)[j] = static_cast<T>(a[i][j]);
+
+  for (int k0 = 0; k0 < n; k0 += block_size) {
+    const int k1 = std::min(k0 + block_size, n);
+
+    // panel: columns [k0, k1) of rows [k0, n)
+    for (int k = k0; k != k1; ++k) {
+      int p = k;
+      for (int i = k + 1; i != n; ++i)
+        if (std::abs(Row(i)[k]) > std::abs(Row(p)[k])) p = i;
+
+      pivots_[k] = p;
+      if (p != k) std::swap_ranges(Row(k), Row(k) + n, Row(p));
+
+      const T pivot = Row(k)[k];
+      if (std::abs(pivot) < Gauss::EPS) {
+        singular_ = true;
+        for (int i = k + 1; i != n; ++i) Row(i)[k] = 0;
+        continue;
+      }
+
+      for (int i = k + 1; i != n; ++i) {
+        T* row = Row(i);
+        row[k] /= pivot;
+        for (int j = k + 1; j != k1; ++j) row[j] -= row[k] * Row(k)[j];
+      }
+    }
+
+    if (k1 == n) break;
+
+    // block row of U: columns [k1, n) of rows [k0, k1)
+    for (int k = k0; k != k1; ++k)
+      for (int i = k + 1; i != k1; ++i) {
+        const T l = Row(i)[k];
+        for (int j = k1; j != n; ++j) Row(i)[j] -= l * Row(k)[j];
+      }
+
+    // trailing matrix: rows and columns [k1, n)
+    auto update = [&](int first, int last) {
+      for (int j0 = k1; j0 < n; j0 += tile_width) {
+        const int j1 = std::min(j0 + tile_width, n);
+        for (int i = first; i != last; ++i) {
+          T* row = Row(i);
+          for (int k = k0; k != k1; ++k) {
+            const T l = row[k];
+            if (l == 0) continue;
+            SubtractRow(row + j0, Row(k) + j0, l, j1 - j0, false);
+          }
+        }
+      }
+    };
+
+    const int rest = n - k1;
+    if (pool && pool->Size() > 1 &&
+        static_cast<long long>(rest) * rest >= parallel_grain)
+      pool->ParallelFor(rest, [&](int, int first, int last) {
+        update(k1 + first, k1 + last);
+      });
+    else
+      update(k1, n);
+  }
+}
+
+template <typename T>
+void BasicLU<T>::Solve(const std::vector<double>& b,
+                       std::vector<double>& x) const {
+  if (static_cast<int>(b.size()) != n_)
+    throw std::invalid_argument("Right-hand side of a wrong size");
+  if (singular_) throw std::runtime_error("Matrix is singular");
+
+  x = b;
+  for (int k = 0; k != n_; ++k) std::swap(x[k], x[pivots_[k]]);
+
+  for (int i = 0; i != n_; ++i) {
+    const T* row = Row(i);
+    double sum = x[i];
+    for (int k = 0; k != i; ++k) sum -= row[k] * x[k];
+    x[i] = sum;
+  }
+
+  for (int i = n_ - 1; i >= 0; --i) {
+    const T* row = Row(i);
+    double sum = x[i];
+    for (int k = i + 1; k != n_; ++k) sum -= row[k] * x[k];
+    x[i] = sum / row[i];
+  }
+}
+
+template <typename T>
+void BasicLU<T>::Solve(SimpleGraph<double>& rhs) const {
+  if (rhs.get_rows() != n_)
+    throw std::invalid_argument("Right-hand sides of a wrong size");
+  if (singular_) throw std::runtime_error("Matrix is singular");
+
+  for (int k = 0; k != n_; ++k) rhs.SwapRows(k, pivots_[k]);
+  SolveColumns(rhs, 0, rhs.get_cols());
+}
+
+template <typename T>
+void BasicLU<T>::Solve(SimpleGraph<double>& rhs, ThreadPool& pool) const {
+  if (rhs.get_rows() != n_)
+    throw std::invalid_argument("Right-hand sides of a wrong size");
+  if (singular_) throw std::runtime_error("Matrix is singular");
+
+  for (int k = 0; k != n_; ++k) rhs.SwapRows(k, pivots_[k]);
+  pool.ParallelFor(rhs.get_cols(), [&](int, int first, int last) {
+    SolveColumns(rhs, first, last);
+  });
+}
+
+// forward and back substitution for columns [first, last) of permuted rhs
+template <typename T>
+void BasicLU<T>::SolveColumns(SimpleGraph<double>& rhs, int first,
+                              int last) const {
+  for (int i = 0; i != n_; ++i) {
+    const T* row = Row(i);
+    double* x = &rhs[i][0];
+    for (int k = 0; k != i; ++k) {
+      const double l = row[k];
+      if (l == 0) continue;
+      const double* y = &rhs[k][0];
+      for (int j = first; j != last; ++j) x[j] -= l * y[j];
+    }
+  }
+
+  for (int i = n_ - 1; i >= 0; --i) {
+    const T* row = Row(i);
+    double* x = &rhs[i][0];
+    for (int k = i + 1; k != n_; ++k) {
+      const double u = row[k];
+      if (u == 0) continue;
+      const double* y = &rhs[k][0];
+      for (int j = first; j != last; ++j) x[j] -= u * y[j];
+    }
+    for (int j = first; j != last; ++j) x[j] /= row[i];
+  }
+}
+
+template class BasicLU<double>;
+template class BasicLU<float>;
+
+}  // namespace gaussmethod
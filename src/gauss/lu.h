@@ -0,0 +1,62 @@
+#ifndef LU_H_
+#define LU_H_
+
+#include <vector>
+
+#include "../matrixallocator.h"
+#include "../simplegraph.h"
+#include "../threadpool.h"
+
+namespace gaussmethod {
+
+// P * A = L * U factorisation with partial pivoting. Factor once, then solve
+// for any number of right-hand sides at O(n^2) each. The factors are kept as
+// T; with float they take half the memory and factor with twice the vector
+// lanes, while solving still works in double.
+template <typename T>
+class BasicLU {
+ public:
+  BasicLU() : n_{0}, stride_{0}, singular_{false} {}
+  explicit BasicLU(const SimpleGraph<double>& a) : BasicLU() { Factor(a); }
+
+  // Factors the leading rows x rows block of a, so an augmented matrix of
+  // Gauss::Solve can be passed as is. With a pool the trailing updates of
+  // the blocked algorithm are split over its threads.
+  void Factor(const SimpleGraph<double>& a);
+  void Factor(const SimpleGraph<double>& a, ThreadPool& pool);
+
+  int Size() const noexcept { return n_; }
+
+  // true if some pivot was below Gauss::EPS; solving then throws, use
+  // Gauss::Solve to tell between no and many solutions
+  bool Singular() const noexcept { return singular_; }
+
+  // x = A^-1 * b
+  void Solve(const std::vector<double>& b, std::vector<double>& x) const;
+
+  // Every column of rhs (Size() rows) is a right-hand side; it is replaced
+  // by its solution. With a pool the columns are split over its threads.
+  void Solve(SimpleGraph<double>& rhs) const;
+  void Solve(SimpleGraph<double>& rhs, ThreadPool& pool) const;
+
+ private:
+  T* Row(int i) noexcept { return lu_.data() + i * stride_; }
+  const T* Row(int i) const noexcept { return lu_.data() + i * stride_; }
+
+  void Factor(const SimpleGraph<double>& a, ThreadPool* pool);
+  void SolveColumns(SimpleGraph<double>& rhs, int first, int last) const;
+
+  int n_;
+  std::size_t stride_;  // of the rows of lu_
+  bool singular_;
+  // L below the diagonal (unit diagonal not stored) and U on and above it
+  std::vector<T, MatrixAllocator<T>> lu_;
+  std::vector<int> pivots_;  // row k was swapped with row pivots_[k]
+};
+
+using LU = BasicLU<double>;
+using FloatLU = BasicLU<float>;
+
+}  // namespace gaussmethod
+
+#endif  // LU_H_
@@ -0,0 +1,22 @@
+#ifndef GAUSS_PARALLEL_H_
+#define GAUSS_PARALLEL_H_
+
+#include "../threadpool.h"
+
+namespace gaussmethod {
+
+// Matrix entries a step (an elimination step, a trailing update, a product)
+// has to touch before splitting it over a pool pays for waking the workers.
+constexpr long long parallel_grain = 1 << 14;
+
+// One worker per hardware thread, used by every solver that is not given a
+// pool of its own, so that solvers running together share the cores rather
+// than each bringing a full set of threads.
+inline ThreadPool& DefaultPool() {
+  static ThreadPool pool;
+  return pool;
+}
+
+}  // namespace gaussmethod
+
+#endif  // GAUSS_PARALLEL_H_
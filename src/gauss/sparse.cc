@@ -0,0 +1,323 @@
+#include "sparse.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+#include "gauss.h"
+
+namespace gaussmethod {
+
+namespace {
+
+// a candidate on the diagonal is taken while it is at least this part of
+// the largest one, which keeps the fill the ordering planned for
+const double pivot_threshold = 0.1;
+
+// Vertices of the graph of A + A^T in the order of approximate minimum
+// degree elimination. The graph is kept in quotient form: an eliminated
+// vertex becomes an element standing for the clique of its neighbours, and
+// the elements it touched are absorbed into it, so the fill is never built
+// edge by edge.
+std::vector<int> MinimumDegreeOrder(const CsrMatrix& a) {
+  const int n = a.rows;
+
+  std::vector<std::vector<int>> adjacent(n);  // variables
+  for (int i = 0; i != n; ++i)
+    for (int k = a.row_start[i]; k != a.row_start[i + 1]; ++k) {
+      const int j = a.col_index[k];
+      if (j == i) continue;
+      adjacent[i].push_back(j);
+      adjacent[j].push_back(i);
+    }
+  for (std::vector<int>& list : adjacent) {
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+  }
+
+  std::vector<std::vector<int>> elements(n);  // of every variable
+  std::vector<std::vector<int>> members(n);   // variables of every element
+  std::vector<char> eliminated(n, 0);
+  std::vector<char> absorbed(n, 0);
+  std::vector<int> outside(n);
+
+  // marks[i] == stamp: i is already counted by the current pass
+  std::vector<unsigned> marks(n, 0);
+  unsigned stamp = 0;
+
+  // (degree, vertex); entries whose degree went out of date are skipped
+  using Entry = std::pair<int, int>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+  std::vector<int> degree(n);
+  for (int i = 0; i != n; ++i) {
+    degree[i] = static_cast<int>(adjacent[i].size());
+    queue.push({degree[i], i});
+  }
+
+  std::vector<int> order;
+  order.reserve(n);
+
+  while (!queue.empty()) {
+    const auto [d, v] = queue.top();
+    queue.pop();
+    if (eliminated[v] || d != degree[v]) continue;
+
+    eliminated[v] = 1;
+    order.push_back(v);
+
+    // the new element: every variable v is connected to
+    std::vector<int>& clique = members[v];
+    ++stamp;
+    marks[v] = stamp;
+    for (int w : adjacent[v])
+      if (!eliminated[w] && marks[w] != stamp) {
+        marks[w] = stamp;
+        clique.push_back(w);
+      }
+    for (int e : elements[v]) {
+      if (absorbed[e]) continue;
+      absorbed[e] = 1;
+      for (int w : members[e])
+        if (!eliminated[w] && marks[w] != stamp) {
+          marks[w] = stamp;
+          clique.push_back(w);
+        }
+      std::vector<int>().swap(members[e]);
+    }
+    std::vector<int>().swap(adjacent[v]);
+    std::vector<int>().swap(elements[v]);
+    const unsigned in_clique = stamp;
+
+    for (int u : clique) {
+      // edges inside the clique are covered by the element now
+      auto& vars = adjacent[u];
+      vars.erase(std::remove_if(vars.begin(), vars.end(),
+                                [&](int w) {
+                                  return eliminated[w] ||
+                                         marks[w] == in_clique;
+                                }),
+                 vars.end());
+      auto& elems = elements[u];
+      elems.erase(std::remove_if(elems.begin(), elems.end(),
+                                 [&](int e) { return absorbed[e] != 0; }),
+                  elems.end());
+      elems.push_back(v);
+    }
+
+    // approximate degrees as in AMD: outside[e] = |e \ clique| is found
+    // for all elements next to the clique at once, then the degree of u
+    // is bounded by its variables, the clique and those parts
+    const int size = static_cast<int>(clique.size());
+    ++stamp;
+    for (int u : clique)
+      for (int e : elements[u]) {
+        if (e == v) continue;
+        if (marks[e] != stamp) {
+          marks[e] = stamp;
+          outside[e] = static_cast<int>(members[e].size());
+        }
+        --outside[e];
+      }
+
+    const int left = n - static_cast<int>(order.size());
+    for (int u : clique) {
+      int bound = static_cast<int>(adjacent[u].size()) + size - 1;
+      for (int e : elements[u])
+        if (e != v) bound += outside[e];
+      degree[u] = std::min({left - 1, degree[u] + size - 1, bound});
+      queue.push({degree[u], u});
+    }
+  }
+
+  return order;
+}
+
+}  // namespace
+
+void CsrMatrix::Check() const {
+  if (rows < 0 || cols < 0 ||
+      row_start.size() != static_cast<std::size_t>(rows) + 1 ||
+      row_start.front() != 0 || col_index.size() != values.size() ||
+      row_start.back() != NonZeros())
+    throw std::invalid_argument("Inconsistent sparse matrix");
+
+  for (int i = 0; i != rows; ++i) {
+    if (row_start[i] > row_start[i + 1])
+      throw std::invalid_argument("Inconsistent sparse matrix");
+    for (int k = row_start[i]; k != row_start[i + 1]; ++k)
+      if (col_index[k] < 0 || col_index[k] >= cols)
+        throw std::invalid_argument("Sparse matrix column out of range");
+  }
+}
+
+CsrMatrix CsrMatrix::FromDense(const SimpleGraph<double>& a, int cols) {
+  if (cols < 0 || cols > a.get_cols())
+    throw std::invalid_argument("Too many columns requested");
+
+  CsrMatrix result;
+  result.rows = a.get_rows();
+  result.cols = cols;
+  for (int i = 0; i != a.get_rows(); ++i) {
+    for (int j = 0; j != cols; ++j)
+      if (a[i][j] != 0) {
+        result.col_index.push_back(j);
+        result.values.push_back(a[i][j]);
+      }
+    result.row_start.push_back(result.NonZeros());
+  }
+  return result;
+}
+
+// Left-looking (Gilbert-Peierls) LU: column k of the factors is a sparse
+// triangular solve with the columns of L found so far, visiting only the
+// rows its pattern reaches, in topological order.
+void SparseLU::Factor(const CsrMatrix& a) {
+  a.Check();
+  if (a.rows == 0 || a.rows != a.cols)
+    throw std::invalid_argument("Sparse LU needs a square matrix");
+
+  const int n = a.rows;
+  n_ = n;
+  singular_ = false;
+
+  order_ = MinimumDegreeOrder(a);
+  std::vector<int> position(n);
+  for (int k = 0; k != n; ++k) position[order_[k]] = k;
+
+  // B = A(q, q) by columns
+  std::vector<int> b_start(n + 1, 0);
+  for (int k = 0; k != a.NonZeros(); ++k)
+    ++b_start[position[a.col_index[k]] + 1];
+  for (int j = 0; j != n; ++j) b_start[j + 1] += b_start[j];
+
+  std::vector<int> b_index(a.NonZeros());
+  std::vector<double> b_values(a.NonZeros());
+  std::vector<int> next(b_start.begin(), b_start.end() - 1);
+  for (int i = 0; i != n; ++i)
+    for (int k = a.row_start[i]; k != a.row_start[i + 1]; ++k) {
+      const int p = next[position[a.col_index[k]]]++;
+      b_index[p] = position[i];
+      b_values[p] = a.values[k];
+    }
+
+  l_start_.assign(1, 0);
+  l_index_.clear();
+  l_values_.clear();
+  u_start_.assign(1, 0);
+  u_index_.clear();
+  u_values_.clear();
+  row_step_.assign(n, -1);
+
+  std::vector<double> x(n, 0);
+  std::vector<int> mark(n, -1);
+  std::vector<int> reach;  // rows of the column, children before parents
+  std::vector<std::pair<int, int>> stack;  // (row, next child)
+
+  for (int k = 0; k != n; ++k) {
+    reach.clear();
+    for (int p = b_start[k]; p != b_start[k + 1]; ++p) {
+      const int start = b_index[p];
+      x[start] += b_values[p];
+      if (mark[start] == k) continue;
+
+      // depth first search through the columns of L
+      mark[start] = k;
+      stack.push_back({start, 0});
+      while (!stack.empty()) {
+        auto& [i, child] = stack.back();
+        const int step = row_step_[i];
+        const int first = step < 0 ? 0 : l_start_[step];
+        const int count = step < 0 ? 0 : l_start_[step + 1] - first;
+
+        while (child != count && mark[l_index_[first + child]] == k) ++child;
+        if (child == count) {
+          reach.push_back(i);
+          stack.pop_back();
+          continue;
+        }
+
+        const int r = l_index_[first + child++];
+        mark[r] = k;
+        stack.push_back({r, 0});
+      }
+    }
+
+    // x = L^-1 * B(:, k) over the reached rows in topological order
+    for (auto it = reach.rbegin(); it != reach.rend(); ++it) {
+      const int step = row_step_[*it];
+      if (step < 0) continue;
+      const double value = x[*it];
+      for (int p = l_start_[step]; p != l_start_[step + 1]; ++p)
+        x[l_index_[p]] -= l_values_[p] * value;
+    }
+
+    int pivot = -1;
+    double largest = 0;
+    for (int i : reach)
+      if (row_step_[i] < 0 && std::abs(x[i]) > largest) {
+        largest = std::abs(x[i]);
+        pivot = i;
+      }
+
+    if (largest < Gauss::EPS) {
+      singular_ = true;
+      return;
+    }
+    if (mark[k] == k && row_step_[k] < 0 &&
+        std::abs(x[k]) >= pivot_threshold * largest)
+      pivot = k;
+
+    for (int i : reach)
+      if (row_step_[i] >= 0) {
+        u_index_.push_back(row_step_[i]);
+        u_values_.push_back(x[i]);
+      }
+    const double diagonal = x[pivot];
+    u_index_.push_back(k);
+    u_values_.push_back(diagonal);
+    u_start_.push_back(static_cast<int>(u_index_.size()));
+
+    row_step_[pivot] = k;
+    for (int i : reach) {
+      if (row_step_[i] < 0 && x[i] != 0) {
+        l_index_.push_back(i);
+        l_values_.push_back(x[i] / diagonal);
+      }
+      x[i] = 0;
+    }
+    l_start_.push_back(static_cast<int>(l_index_.size()));
+  }
+
+  // rows of L from rows of B to pivot steps
+  for (int& i : l_index_) i = row_step_[i];
+}
+
+void SparseLU::Solve(const std::vector<double>& b,
+                     std::vector<double>& x) const {
+  if (static_cast<int>(b.size()) != n_)
+    throw std::invalid_argument("Right-hand side of a wrong size");
+  if (singular_) throw std::runtime_error("Matrix is singular");
+
+  std::vector<double> y(n_);
+  for (int i = 0; i != n_; ++i) y[row_step_[i]] = b[order_[i]];
+
+  for (int j = 0; j != n_; ++j)
+    for (int p = l_start_[j]; p != l_start_[j + 1]; ++p)
+      y[l_index_[p]] -= l_values_[p] * y[j];
+
+  for (int j = n_ - 1; j >= 0; --j) {
+    const int diagonal = u_start_[j + 1] - 1;
+    y[j] /= u_values_[diagonal];
+    for (int p = u_start_[j]; p != diagonal; ++p)
+      y[u_index_[p]] -= u_values_[p] * y[j];
+  }
+
+  x.resize(n_);
+  for (int k = 0; k != n_; ++k) x[order_[k]] = y[k];
+}
+
+}  // namespace gaussmethod
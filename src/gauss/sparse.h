@@ -0,0 +1,69 @@
+#ifndef GAUSS_SPARSE_H_
+#define GAUSS_SPARSE_H_
+
+#include <vector>
+
+#include "../simplegraph.h"
+
+namespace gaussmethod {
+
+// Compressed sparse rows: the entries of row i are values[k] at columns
+// col_index[k] for k in [row_start[i], row_start[i + 1]).
+struct CsrMatrix {
+  int rows{0};
+  int cols{0};
+  std::vector<int> row_start{0};
+  std::vector<int> col_index;
+  std::vector<double> values;
+
+  int NonZeros() const noexcept { return static_cast<int>(values.size()); }
+
+  // throws std::invalid_argument if the arrays do not describe a matrix
+  void Check() const;
+
+  // entries of the leading rows x cols block of a that are not zero
+  static CsrMatrix FromDense(const SimpleGraph<double>& a, int cols);
+};
+
+// P * A(q, q) = L * U factorisation of a sparse square matrix. The symmetric
+// permutation q is a minimum degree ordering of A + A^T, which keeps the
+// fill of the factors low; the rows are then chosen by threshold partial
+// pivoting, preferring the diagonal while it is not much smaller than the
+// largest candidate.
+class SparseLU {
+ public:
+  SparseLU() : n_{0}, singular_{false} {}
+  explicit SparseLU(const CsrMatrix& a) : SparseLU() { Factor(a); }
+
+  void Factor(const CsrMatrix& a);
+
+  int Size() const noexcept { return n_; }
+  bool Singular() const noexcept { return singular_; }
+
+  // entries of L and U together, a measure of the fill
+  int NonZeros() const noexcept {
+    return static_cast<int>(l_values_.size() + u_values_.size());
+  }
+
+  // x = A^-1 * b, throws std::runtime_error for a singular matrix
+  void Solve(const std::vector<double>& b, std::vector<double>& x) const;
+
+ private:
+  int n_;
+  bool singular_;
+
+  std::vector<int> order_;  // column k of the factors is column order_[k]
+
+  // both by columns; the diagonal of U is the last entry of its column and
+  // L has a unit diagonal that is not stored
+  std::vector<int> l_start_, l_index_;
+  std::vector<double> l_values_;
+  std::vector<int> u_start_, u_index_;
+  std::vector<double> u_values_;
+
+  std::vector<int> row_step_;  // row i of A(q, q) became row row_step_[i]
+};
+
+}  // namespace gaussmethod
+
+#endif  // GAUSS_SPARSE_H_
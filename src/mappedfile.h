@@ -0,0 +1,52 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+// Whole file mapped into memory. The mapping is private: the contents can be
+// changed in memory, but the changes never reach the file.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& filename) : data_{nullptr}, size_{0} {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) throw std::invalid_argument("Can not open file " + filename);
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+      close(fd);
+      throw std::invalid_argument("Empty file " + filename);
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+
+    void* addr =
+        mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping stays valid without the descriptor
+
+    if (addr == MAP_FAILED)
+      throw std::invalid_argument("Can not map file " + filename);
+
+    data_ = static_cast<char*>(addr);
+    madvise(data_, size_, MADV_SEQUENTIAL);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() { munmap(data_, size_); }
+
+  char* data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+
+ private:
+  char* data_;
+  std::size_t size_;
+};
+
+#endif  // MAPPED_FILE_H_
@@ -0,0 +1,265 @@
+#ifndef MATRIX_ALLOCATOR_H_
+#define MATRIX_ALLOCATOR_H_
+
+#include <sys/mman.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+// How MatrixAllocator lays out and places the entries of a matrix
+enum MatrixStorage : unsigned {
+  MATRIX_PACKED = 0,
+  // rows start on cache lines, and from 1 KB on a line is added to widths
+  // that are a multiple of 256 bytes, so a column does not map to a few
+  // cache sets
+  MATRIX_PADDED_ROWS = 1,
+  // blocks of matrix_huge_block bytes or more go on 2 MB pages: reserved
+  // ones if the system has some free, transparent ones otherwise
+  MATRIX_HUGE_PAGES = 2
+};
+
+constexpr std::size_t matrix_line = 64;
+constexpr std::size_t matrix_huge_page = std::size_t{2} << 20;
+constexpr std::size_t matrix_huge_block = 2 * matrix_huge_page;
+
+// Entries from the start of a row of cols entries of T to the next one with
+// padded rows: whole cache lines, and one more for rows of 1 KB or more
+// that are a multiple of 4 lines (shorter rows would pay a large share for
+// it). Types that do not tile a line stay packed.
+template <typename T>
+std::size_t PaddedRowStride(int cols) {
+  const std::size_t bytes = sizeof(T) * cols;
+  if (matrix_line % sizeof(T) != 0) return cols;
+
+  std::size_t lines = (bytes + matrix_line - 1) / matrix_line;
+  if (lines >= 16 && lines % 4 == 0) ++lines;
+  return lines * matrix_line / sizeof(T);
+}
+
+// Bytes of memory behind a block of bytes: whole huge pages for large
+// blocks, whole cache lines otherwise.
+inline std::size_t MatrixMemorySize(std::size_t bytes, bool huge_pages) {
+  if (huge_pages && bytes >= matrix_huge_block)
+    return (bytes + matrix_huge_page - 1) / matrix_huge_page * matrix_huge_page;
+  return (bytes + matrix_line - 1) / matrix_line * matrix_line;
+}
+
+// Cache line aligned block of at least bytes bytes, aligned to a huge page
+// and mapped on huge pages if huge_pages is set and the block is large.
+inline void* AllocateMatrixMemory(std::size_t bytes, bool huge_pages) {
+  const std::size_t size = MatrixMemorySize(bytes, huge_pages);
+  if (!huge_pages || bytes < matrix_huge_block)
+    return ::operator new(size, std::align_val_t{matrix_line});
+
+  const int prot = PROT_READ | PROT_WRITE;
+  const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+  void* reserved = mmap(nullptr, size, prot, flags | MAP_HUGETLB, -1, 0);
+  if (reserved != MAP_FAILED) return reserved;
+#endif
+
+  // map a huge page more than needed and trim it to a huge page boundary
+  void* addr = mmap(nullptr, size + matrix_huge_page, prot, flags, -1, 0);
+  if (addr == MAP_FAILED) throw std::bad_alloc();
+
+  char* first = static_cast<char*>(addr);
+  const std::uintptr_t offset =
+      reinterpret_cast<std::uintptr_t>(first) % matrix_huge_page;
+  char* aligned = offset ? first + (matrix_huge_page - offset) : first;
+  if (aligned != first) munmap(first, aligned - first);
+  if (aligned + size != first + size + matrix_huge_page)
+    munmap(aligned + size, first + size + matrix_huge_page - (aligned + size));
+
+#ifdef MADV_HUGEPAGE
+  madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+  return aligned;
+}
+
+inline void FreeMatrixMemory(void* p, std::size_t bytes,
+                             bool huge_pages) noexcept {
+  if (!huge_pages || bytes < matrix_huge_block)
+    ::operator delete(p, std::align_val_t{matrix_line});
+  else
+    munmap(p, MatrixMemorySize(bytes, huge_pages));
+}
+
+// Allocator for SimpleGraph and other row-major matrices. Storage is a set
+// of MatrixStorage flags; RowStride gives the layout of the rows they ask
+// for.
+template <typename T,
+          unsigned Storage = MATRIX_PADDED_ROWS | MATRIX_HUGE_PAGES>
+struct MatrixAllocator {
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = MatrixAllocator<U, Storage>;
+  };
+
+  MatrixAllocator() noexcept = default;
+  template <typename U>
+  MatrixAllocator(const MatrixAllocator<U, Storage>&) noexcept {}
+
+  static std::size_t RowStride(int cols) {
+    return Storage & MATRIX_PADDED_ROWS ? PaddedRowStride<T>(cols) : cols;
+  }
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(AllocateMatrixMemory(n * sizeof(T), huge_pages));
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept {
+    FreeMatrixMemory(p, n * sizeof(T), huge_pages);
+  }
+
+ private:
+  static constexpr bool huge_pages = Storage & MATRIX_HUGE_PAGES;
+};
+
+template <typename T, typename U, unsigned S>
+bool operator==(const MatrixAllocator<T, S>&, const MatrixAllocator<U, S>&) {
+  return true;
+}
+
+template <typename T, typename U, unsigned S>
+bool operator!=(const MatrixAllocator<T, S>&, const MatrixAllocator<U, S>&) {
+  return false;
+}
+
+// Row stride of a matrix of cols columns kept by Allocator: its RowStride,
+// or cols for allocators without one
+template <typename Allocator, typename = void>
+struct MatrixRowStride {
+  static std::size_t Get(int cols) { return cols; }
+};
+
+template <typename Allocator>
+struct MatrixRowStride<Allocator,
+                       std::void_t<decltype(Allocator::RowStride(0))>> {
+  static std::size_t Get(int cols) { return Allocator::RowStride(cols); }
+};
+
+// Freed blocks kept for the next allocation of the same size, so that the
+// temporaries of a product or a solve neither go back to the system nor
+// fault their pages in again. Blocks are only kept while a Scope is open
+// and go back to the system when the last one closes, or at once past
+// limit bytes in all. Large blocks are on huge pages.
+class MatrixPool {
+ public:
+  static constexpr std::size_t limit = std::size_t{128} << 20;
+
+  // the blocks of the shared pool freed while it lives are kept for reuse
+  class Scope {
+   public:
+    Scope() { Shared().Open(); }
+    ~Scope() { Shared().Close(); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+  };
+
+  MatrixPool() = default;
+  MatrixPool(const MatrixPool&) = delete;
+  MatrixPool& operator=(const MatrixPool&) = delete;
+
+  ~MatrixPool() { Release(); }
+
+  // the pool of PoolAllocator, never destroyed, so that blocks can still
+  // come back to it while the program exits
+  static MatrixPool& Shared() {
+    static MatrixPool* pool = new MatrixPool;
+    return *pool;
+  }
+
+  void* Allocate(std::size_t bytes) {
+    const std::size_t size = MatrixMemorySize(bytes, true);
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      auto it = free_.find(size);
+      if (it != free_.end()) {
+        void* p = it->second;
+        free_.erase(it);
+        kept_ -= size;
+        return p;
+      }
+    }
+    return AllocateMatrixMemory(size, true);
+  }
+
+  void Deallocate(void* p, std::size_t bytes) noexcept {
+    const std::size_t size = MatrixMemorySize(bytes, true);
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (scopes_ > 0 && kept_ + size <= limit) {
+        free_.emplace(size, p);
+        kept_ += size;
+        return;
+      }
+    }
+    FreeMatrixMemory(p, size, true);
+  }
+
+  // returns every kept block to the system
+  void Release() noexcept {
+    std::lock_guard<std::mutex> lock(mtx_);
+    ReleaseLocked();
+  }
+
+ private:
+  void Open() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    ++scopes_;
+  }
+
+  void Close() noexcept {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (--scopes_ == 0) ReleaseLocked();
+  }
+
+  void ReleaseLocked() noexcept {
+    for (auto& [size, p] : free_) FreeMatrixMemory(p, size, true);
+    free_.clear();
+    kept_ = 0;
+  }
+
+  std::mutex mtx_;
+  std::multimap<std::size_t, void*> free_;
+  std::size_t kept_{0};
+  int scopes_{0};
+};
+
+// Allocator for temporaries, taking its blocks from MatrixPool::Shared();
+// open a MatrixPool::Scope around the work that makes them
+template <typename T>
+struct PoolAllocator {
+  using value_type = T;
+
+  PoolAllocator() noexcept = default;
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(MatrixPool::Shared().Allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept {
+    MatrixPool::Shared().Deallocate(p, n * sizeof(T));
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+  return false;
+}
+
+#endif  // MATRIX_ALLOCATOR_H_
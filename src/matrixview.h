@@ -0,0 +1,76 @@
+#ifndef MATRIX_VIEW_H_
+#define MATRIX_VIEW_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+#include "simplegraph.h"
+
+// Non-owning rows x cols window on row-major storage whose rows are stride
+// entries apart: a whole SimpleGraph, a block of one or a buffer of the
+// caller. Views are cheap to copy and never copy the entries; the storage
+// must outlive them. MatrixView<const T> only reads.
+template <typename T>
+class MatrixView {
+ public:
+  using value_type = std::remove_const_t<T>;
+
+  MatrixView() noexcept = default;
+  MatrixView(T* data, int rows, int cols, std::size_t stride) noexcept
+      : data_{data}, rows_{rows}, cols_{cols}, stride_{stride} {}
+
+  // the whole of a matrix; a const one gives read-only views only
+  template <typename A>
+  MatrixView(SimpleGraph<value_type, A>& graph) noexcept
+      : MatrixView(graph.data(), graph.get_rows(), graph.get_cols(),
+                   graph.get_stride()) {}
+  template <typename A, typename U = T,
+            typename = std::enable_if_t<std::is_const_v<U>>>
+  MatrixView(const SimpleGraph<value_type, A>& graph) noexcept
+      : MatrixView(graph.data(), graph.get_rows(), graph.get_cols(),
+                   graph.get_stride()) {}
+
+  // read-only view of a writable one
+  template <typename U = T, typename = std::enable_if_t<std::is_const_v<U>>>
+  MatrixView(const MatrixView<value_type>& other) noexcept
+      : MatrixView(other.data(), other.get_rows(), other.get_cols(),
+                   other.get_stride()) {}
+
+  int get_rows() const noexcept { return rows_; }
+  int get_cols() const noexcept { return cols_; }
+  std::size_t get_stride() const noexcept { return stride_; }
+  T* data() const noexcept { return data_; }
+
+  T* operator[](int row) const noexcept { return data_ + row * stride_; }
+
+  // rows x cols block with its first entry at (row, col)
+  MatrixView Block(int row, int col, int rows, int cols) const {
+    if (row < 0 || col < 0 || rows < 0 || cols < 0 || row + rows > rows_ ||
+        col + cols > cols_)
+      throw std::out_of_range("Block is out of the matrix");
+    return {data_ + row * stride_ + col, rows, cols, stride_};
+  }
+
+  void SwapRows(int r1, int r2) const {
+    if (r1 != r2)
+      std::swap_ranges((*this)[r1], (*this)[r1] + cols_, (*this)[r2]);
+  }
+
+  // copies the entries of a matrix of the same size in
+  void Assign(MatrixView<const value_type> from) const {
+    if (from.get_rows() != rows_ || from.get_cols() != cols_)
+      throw std::invalid_argument("Matrices of different sizes");
+    for (int i = 0; i != rows_; ++i)
+      std::copy(from[i], from[i] + cols_, (*this)[i]);
+  }
+
+ private:
+  T* data_{nullptr};
+  int rows_{0};
+  int cols_{0};
+  std::size_t stride_{0};
+};
+
+#endif  // MATRIX_VIEW_H_
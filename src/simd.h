@@ -0,0 +1,23 @@
+#ifndef SIMD_H_
+#define SIMD_H_
+
+// Widest vector extension of the CPU the program runs on. Kernels built for
+// several extensions pick their variant with it once, at first use.
+enum SimdLevel { SIMD_SCALAR = 0, SIMD_AVX2, SIMD_AVX512 };
+
+inline SimdLevel DetectSimd() {
+#if defined(__x86_64__) || defined(__i386__)
+  static const SimdLevel level = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+      return SIMD_AVX2;
+    return SIMD_SCALAR;
+  }();
+  return level;
+#else
+  return SIMD_SCALAR;
+#endif
+}
+
+#endif  // SIMD_H_
@@ -1,11 +1,26 @@
 #ifndef SIMPLE_GRAPH_H_
 #define SIMPLE_GRAPH_H_
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
-template <typename T>
+#include "mappedfile.h"
+#include "matrixallocator.h"
+
+// Row-major matrix. Allocator decides where the entries live and, through
+// its RowStride, how far apart the rows are; the default one pads rows off
+// cache-aliasing widths and puts large matrices on huge pages.
+template <typename T, typename Allocator = MatrixAllocator<T>>
 class SimpleGraph {
  private:
   struct ProxyRow {
@@ -17,42 +32,111 @@ class SimpleGraph {
     const T& operator[](int n) const { return row[n]; }
   };
 
+  // Binary file: this header, then rows * cols values of T in native byte
+  // order and row-major order, starting at byte binary_offset
+  struct BinaryHeader {
+    char magic[8];
+    std::uint32_t type;  // sizeof(T), plus 0x100 for floating point types
+    std::uint32_t reserved;
+    std::int64_t rows;
+    std::int64_t cols;
+  };
+
+  constexpr static char binary_magic[8] = "SGRAPH1";
+  constexpr static std::size_t binary_offset = 64;
+  constexpr static std::uint32_t binary_type =
+      sizeof(T) + (std::is_floating_point<T>::value ? 0x100 : 0);
+
   bool Directed() const noexcept;
 
  public:
-  SimpleGraph() : adjacent_{}, rows{0}, cols{0} /* directed{false} */ {}
+  SimpleGraph()
+      : adjacent_{}, data_{nullptr}, stride_{0}, rows{0}, cols{0} {}
   SimpleGraph(int r, int c) {
     if (r < 2 || c < 2)
       throw std::invalid_argument("please, create matrices, not rows or smth");
 
-    adjacent_.resize(r * c);
+    stride_ = MatrixRowStride<Allocator>::Get(c);
+    adjacent_.resize(r * stride_);
+    data_ = adjacent_.data();
     rows = r;
     cols = c;
   }
 
-  void LoadGraphFromFile(const std::string& filename) {
-    std::ifstream istrm;
-    istrm.open(filename, std::ios_base::in);
+  // a copy always owns its values, even if the source is a mapped file
+  SimpleGraph(const SimpleGraph& other)
+      : adjacent_(other.rows * MatrixRowStride<Allocator>::Get(other.cols)),
+        data_{adjacent_.data()},
+        stride_{MatrixRowStride<Allocator>::Get(other.cols)},
+        rows{other.rows},
+        cols{other.cols} {
+    for (int i = 0; i != rows; ++i)
+      std::copy(other[i].row, other[i].row + cols, (*this)[i].row);
+  }
 
-    if (!istrm.is_open())
-      throw std::invalid_argument("Can not open file " + filename);
+  SimpleGraph(SimpleGraph&& other) noexcept
+      : adjacent_(std::move(other.adjacent_)),
+        mapping_(std::move(other.mapping_)),
+        data_{other.data_},
+        stride_{other.stride_},
+        rows{other.rows},
+        cols{other.cols} {
+    other.adjacent_.clear();
+    other.data_ = nullptr;
+    other.stride_ = 0;
+    other.rows = other.cols = 0;
+  }
 
-    istrm >> rows >> cols;
+  SimpleGraph& operator=(SimpleGraph other) noexcept {
+    std::swap(adjacent_, other.adjacent_);
+    std::swap(mapping_, other.mapping_);
+    std::swap(data_, other.data_);
+    std::swap(stride_, other.stride_);
+    std::swap(rows, other.rows);
+    std::swap(cols, other.cols);
+    return *this;
+  }
 
-    adjacent_.resize(rows * cols);
+  // Reads a text file ("rows cols" and then the values, separated by
+  // whitespace) or a binary file written by SaveGraphToBinaryFile. A binary
+  // file is mapped into memory and used in place: nothing is copied until
+  // a page is written to, and writes never reach the file.
+  void LoadGraphFromFile(const std::string& filename) {
+    auto file = std::make_shared<MappedFile>(filename);
 
-    for (std::size_t i = 0; i < adjacent_.size(); ++i) {
-      istrm >> adjacent_[i];
-    }
+    if (file->size() >= sizeof(BinaryHeader) &&
+        std::memcmp(file->data(), binary_magic, sizeof(binary_magic)) == 0)
+      LoadBinary(std::move(file), filename);
+    else
+      LoadText(*file, filename);
 
     /* directed = Directed(); */
+  }
+
+  void SaveGraphToBinaryFile(const std::string& filename) const {
+    std::ofstream ostrm(filename, std::ios_base::out | std::ios_base::binary);
+    if (!ostrm.is_open())
+      throw std::invalid_argument("Can not open file " + filename);
+
+    BinaryHeader header{};
+    std::memcpy(header.magic, binary_magic, sizeof(binary_magic));
+    header.type = binary_type;
+    header.rows = rows;
+    header.cols = cols;
 
-    istrm.close();
+    char head[binary_offset] = {0};
+    std::memcpy(head, &header, sizeof(header));
+    ostrm.write(head, binary_offset);
+    for (int i = 0; i != rows; ++i)
+      ostrm.write(reinterpret_cast<const char*>((*this)[i].row),
+                  static_cast<std::streamsize>(sizeof(T)) * cols);
+
+    if (!ostrm) throw std::runtime_error("Can not write file " + filename);
   }
 
   /* bool IsDirect() const noexcept { return directed; } */
 
-  bool Empty() const noexcept { return adjacent_.empty(); }
+  bool Empty() const noexcept { return rows == 0 || cols == 0; }
 
   int Size() const noexcept { return rows; }
 
@@ -62,48 +146,127 @@ class SimpleGraph {
 
     if (r1 == r2) return;
 
-    for (int j = 0; j != cols; ++j)
-      std::swap(adjacent_[r1 * cols + j], adjacent_[r2 * cols + j]);
+    std::swap_ranges((*this)[r1].row, (*this)[r1].row + cols, (*this)[r2].row);
   }
 
   int get_rows() const { return rows; }
   int get_cols() const { return cols; }
 
+  // entries from the start of a row to the start of the next one
+  std::size_t get_stride() const { return stride_; }
+
+  // first entry, row i starting get_stride() * i entries after it
+  T* data() noexcept { return data_; }
+  const T* data() const noexcept { return data_; }
+
  public:
-  ProxyRow operator[](int row) { return adjacent_.data() + row * cols; }
+  ProxyRow operator[](int row) { return data_ + row * stride_; }
 
-  const ProxyRow operator[](int row) const {
-    return adjacent_.data() + row * cols;
-  }
+  const ProxyRow operator[](int row) const { return data_ + row * stride_; }
 
   void dump(std::ostream& os) const {
     for (int i = 0; i != rows; ++i) {
       for (int j = 0; j != cols; ++j) {
-        os << adjacent_[i * cols + j] << " ";
+        os << (*this)[i][j] << " ";
       }
       os << "\n";
     }
   }
 
-  bool IsEqual(const SimpleGraph<T>& gr) const {
-    return rows == gr.rows && cols == gr.cols && adjacent_ == gr.adjacent_;
+  bool IsEqual(const SimpleGraph& gr) const {
+    if (rows != gr.rows || cols != gr.cols) return false;
+    for (int i = 0; i != rows; ++i)
+      if (!std::equal((*this)[i].row, (*this)[i].row + cols, gr[i].row))
+        return false;
+    return true;
   }
 
  private:
-  std::vector<T> adjacent_;
+  template <typename U>
+  static const char* ParseValue(const char* first, const char* last, U& value,
+                                const std::string& filename) {
+    while (first != last && std::isspace(static_cast<unsigned char>(*first)))
+      ++first;
+    // from_chars takes no plus sign, but operator>> did
+    if (last - first > 1 && first[0] == '+' && first[1] != '-') ++first;
+
+    auto [ptr, ec] = std::from_chars(first, last, value);
+    if (ec != std::errc() ||
+        (ptr != last && !std::isspace(static_cast<unsigned char>(*ptr))))
+      throw std::invalid_argument("Incorrect value in file " + filename);
+
+    return ptr;
+  }
+
+  void LoadText(const MappedFile& file, const std::string& filename) {
+    const char* first = file.data();
+    const char* last = first + file.size();
+
+    int r = 0, c = 0;
+    first = ParseValue(first, last, r, filename);
+    first = ParseValue(first, last, c, filename);
+    if (r < 0 || c < 0)
+      throw std::invalid_argument("Incorrect size in file " + filename);
+
+    const std::size_t stride = MatrixRowStride<Allocator>::Get(c);
+    std::vector<T, Allocator> values(r * stride);
+    for (int i = 0; i != r; ++i)
+      for (int j = 0; j != c; ++j)
+        first = ParseValue(first, last, values[i * stride + j], filename);
+
+    adjacent_ = std::move(values);
+    mapping_.reset();
+    data_ = adjacent_.data();
+    stride_ = stride;
+    rows = r;
+    cols = c;
+  }
+
+  void LoadBinary(std::shared_ptr<MappedFile> file,
+                  const std::string& filename) {
+    BinaryHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+
+    if (header.type != binary_type)
+      throw std::invalid_argument("Other value type in file " + filename);
+    // checked by division, so that a crafted size can not overflow past it
+    const std::size_t values = file->size() < binary_offset
+                                   ? 0
+                                   : (file->size() - binary_offset) / sizeof(T);
+    if (header.rows < 0 || header.cols < 0 || header.rows > INT_MAX ||
+        header.cols > INT_MAX)
+      throw std::invalid_argument("Incorrect size in file " + filename);
+    const auto r = static_cast<std::size_t>(header.rows);
+    const auto c = static_cast<std::size_t>(header.cols);
+    if (c != 0 && r > values / c)
+      throw std::invalid_argument("Incorrect size in file " + filename);
+
+    adjacent_.clear();
+    adjacent_.shrink_to_fit();
+    data_ = reinterpret_cast<T*>(file->data() + binary_offset);
+    mapping_ = std::move(file);
+    stride_ = static_cast<std::size_t>(header.cols);
+    rows = static_cast<int>(header.rows);
+    cols = static_cast<int>(header.cols);
+  }
+
+  std::vector<T, Allocator> adjacent_;
+  std::shared_ptr<MappedFile> mapping_;  // set if data_ points into a file
+  T* data_;
+  std::size_t stride_;  // cols for a mapped file
   int rows;
   int cols;
   /* bool directed; */
 };
 
-template <typename T>
-inline std::ostream& operator<<(std::ostream& os, const SimpleGraph<T>& g) {
+template <typename T, typename A>
+inline std::ostream& operator<<(std::ostream& os, const SimpleGraph<T, A>& g) {
   g.dump(os);
   return os;
 }
 
-template <typename T>
-bool operator==(const SimpleGraph<T>& lhs, const SimpleGraph<T>& rhs) {
+template <typename T, typename A>
+bool operator==(const SimpleGraph<T, A>& lhs, const SimpleGraph<T, A>& rhs) {
   return lhs.IsEqual(rhs);
 }
 
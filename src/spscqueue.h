@@ -0,0 +1,66 @@
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread. Push waits while the queue is full and Pop while it is
+// empty, yielding the processor in between, until a cancel flag shared by
+// both ends is set: a failing side sets it so that the other one does not
+// wait for it forever.
+template <typename T>
+class SpscQueue {
+ public:
+  // one slot always stays free to tell a full ring from an empty one
+  explicit SpscQueue(int capacity) : slots_(capacity + 1) {}
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  bool TryPush(const T& value) {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    const std::size_t next = tail + 1 == slots_.size() ? 0 : tail + 1;
+    if (next == head_.load(std::memory_order_acquire)) return false;
+    slots_[tail] = value;
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T& value) {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return false;
+    value = slots_[head];
+    head_.store(head + 1 == slots_.size() ? 0 : head + 1,
+                std::memory_order_release);
+    return true;
+  }
+
+  // false if cancel was set before the value went in
+  bool Push(const T& value, const std::atomic<bool>& cancel) {
+    while (!TryPush(value)) {
+      if (cancel.load(std::memory_order_relaxed)) return false;
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+  // false if cancel was set before a value came
+  bool Pop(T& value, const std::atomic<bool>& cancel) {
+    while (!TryPop(value)) {
+      if (cancel.load(std::memory_order_relaxed)) return false;
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+ private:
+  std::vector<T> slots_;
+  // each end on its own cache line, written by its own thread
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+};
+
+#endif  // SPSC_QUEUE_H_
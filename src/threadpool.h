@@ -0,0 +1,127 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Fixed set of worker threads that live as long as the pool does. The thread
+// calling Run() takes part in the job as worker 0, so a pool of size 1 has no
+// background threads and runs everything inline.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int threads = 0) {
+    if (threads < 1)
+      threads = std::max(
+          1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    workers_.reserve(threads - 1);
+    for (int w = 1; w < threads; ++w)
+      workers_.emplace_back(&ThreadPool::WorkerLoop, this, w);
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (std::thread& t : workers_) t.join();
+  }
+
+  int Size() const noexcept { return static_cast<int>(workers_.size()) + 1; }
+
+  // Calls job(worker) once on every worker and waits for all of them. The
+  // first exception thrown by any worker is rethrown here. Must not be called
+  // from inside a job of the same pool.
+  void Run(const std::function<void(int)>& job) {
+    std::lock_guard<std::mutex> run_lock(run_mtx_);
+
+    if (workers_.empty()) {
+      job(0);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      job_ = &job;
+      pending_ = workers_.size();
+      error_ = nullptr;
+      ++generation_;
+    }
+    start_cv_.notify_all();
+
+    Execute(0);
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    done_cv_.wait(lock, [this] { return pending_ == 0; });
+    job_ = nullptr;
+    if (error_) std::rethrow_exception(std::exchange(error_, nullptr));
+  }
+
+  // Splits [0, count) into Size() contiguous blocks of nearly equal length
+  // and calls func(worker, begin, end) for every non-empty one.
+  template <typename Func>
+  void ParallelFor(int count, Func&& func) {
+    const int size = Size();
+    Run([&](int worker) {
+      const int begin = BlockBegin(count, size, worker);
+      const int end = BlockBegin(count, size, worker + 1);
+      if (begin < end) func(worker, begin, end);
+    });
+  }
+
+  static int BlockBegin(int count, int blocks, int block) noexcept {
+    return static_cast<int>(static_cast<long long>(count) * block / blocks);
+  }
+
+ private:
+  void Execute(int worker) {
+    try {
+      (*job_)(worker);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (!error_) error_ = std::current_exception();
+    }
+  }
+
+  void WorkerLoop(int worker) {
+    unsigned long long seen = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mtx_);
+        start_cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_) return;
+        seen = generation_;
+      }
+
+      Execute(worker);
+
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (--pending_ == 0) done_cv_.notify_one();
+    }
+  }
+
+  std::vector<std::thread> workers_;
+
+  std::mutex run_mtx_;
+  std::mutex mtx_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+
+  const std::function<void(int)>* job_{nullptr};
+  std::size_t pending_{0};
+  unsigned long long generation_{0};
+  std::exception_ptr error_;
+  bool stop_{false};
+};
+
+#endif  // THREAD_POOL_H_
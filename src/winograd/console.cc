@@ -13,14 +13,22 @@ bool Printable(const Console::d_graph& gr, int xmax, int ymax);
 void print_result_window(WINDOW* output, double ms);
 void print_error_window(WINDOW* output, const char* msg);
 
+// result gets the size of the product of lhs and rhs, keeping its storage
+// when it has the size already, so that the runs below never allocate it
+void PrepareResult(Console::d_graph& result, const Console::d_graph& lhs,
+                   const Console::d_graph& rhs) {
+  if (result.get_rows() != lhs.get_rows() ||
+      result.get_cols() != rhs.get_cols())
+    result = Console::d_graph(lhs.get_rows(), rhs.get_cols());
+}
+
 template <typename Function, typename... Args>
 double RunMultiplication(int exec_num, Console::d_graph& result,
                          Function&& func, Args&&... args) {
   auto t1 = std::chrono::high_resolution_clock::now();
 
   while (exec_num--) {
-    result =
-        std::invoke(std::forward<Function>(func), std::forward<Args>(args)...);
+    std::invoke(std::forward<Function>(func), result, args...);
   }
 
   auto t2 = std::chrono::high_resolution_clock::now();
@@ -103,8 +111,9 @@ void Console::Run() {
           if (classic_res_win) delwin(classic_res_win);
           classic_res_win = newwin(5, maxx / 2, maxy - 6, 0);
           try {
+            PrepareResult(result, mtrxs.first, mtrxs.second);
             double cl_time =
-                RunMultiplication(exec_num, result, &Winograd::Multiply,
+                RunMultiplication(exec_num, result, &Winograd::MultiplyInto,
                                   mtrxs.first, mtrxs.second);
             print_result_window(classic_res_win, cl_time);
           } catch (const std::exception& e) {
@@ -120,9 +129,11 @@ void Console::Run() {
           if (parallel_res_win) delwin(parallel_res_win);
           parallel_res_win = newwin(5, maxx / 2, maxy - 6, maxx / 2);
           try {
+            PrepareResult(async_result, mtrxs.first, mtrxs.second);
             double pr_time = RunMultiplication(
-                exec_num, async_result, &Winograd::AsyncMultiply, mtrxs.first,
-                mtrxs.second, threads_num);
+                exec_num, async_result,
+                [](auto&&... args) { Winograd::AsyncMultiplyInto(args...); },
+                mtrxs.first, mtrxs.second, threads_num);
             print_result_window(parallel_res_win, pr_time);
           } catch (const std::exception& e) {
             print_error_window(parallel_res_win, e.what());
@@ -135,9 +146,30 @@ void Console::Run() {
           parallel_res_win = newwin(5, maxx / 2, maxy - 6, maxx / 2);
 
           try {
-            double pr_time = RunMultiplication(exec_num, result,
-                                               &Winograd::AsyncPipelineMultiply,
-                                               mtrxs.first, mtrxs.second);
+            PrepareResult(result, mtrxs.first, mtrxs.second);
+            double pr_time = RunMultiplication(
+                exec_num, result,
+                [](auto&&... args) {
+                  Winograd::AsyncPipelineMultiplyInto(args...);
+                },
+                mtrxs.first, mtrxs.second, 0, Winograd::pipeline_depth);
+            print_result_window(parallel_res_win, pr_time);
+          } catch (const std::exception& e) {
+            print_error_window(parallel_res_win, e.what());
+          }
+          break;
+        }
+        case RUN_4: {
+          if (exec_num < 1 || threads_num < 1) break;
+
+          if (parallel_res_win) delwin(parallel_res_win);
+          parallel_res_win = newwin(5, maxx / 2, maxy - 6, maxx / 2);
+          try {
+            PrepareResult(async_result, mtrxs.first, mtrxs.second);
+            double pr_time = RunMultiplication(
+                exec_num, async_result, &Winograd::StrassenMultiplyInto,
+                mtrxs.first, mtrxs.second, threads_num,
+                Winograd::strassen_cutoff);
             print_result_window(parallel_res_win, pr_time);
           } catch (const std::exception& e) {
             print_error_window(parallel_res_win, e.what());
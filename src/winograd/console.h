@@ -18,6 +18,7 @@ class Console final : public BaseConsole {
       "RUN (classic)",
       "RUN (parallel 'n' threads)",
       "RUN (pipeline parallel)",
+      "RUN (Strassen-Winograd 'n' threads)",
       "Exit"};
 
   enum Action {
@@ -30,6 +31,7 @@ class Console final : public BaseConsole {
     RUN_1,
     RUN_2,
     RUN_3,
+    RUN_4,
     EXIT
   };
   enum MATRIX { FIRST = 0, SECOND, CL_RES, PAR_RES };
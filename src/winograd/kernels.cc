@@ -0,0 +1,196 @@
+#include "kernels.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "../matrixallocator.h"
+#include "../simd.h"
+
+namespace winograd {
+
+namespace {
+
+const int mr = 4;    // rows of a register tile
+const int nr = 8;    // columns of a register tile
+const int kc = 128;  // pairs of a packed panel, a tile strip stays in L1
+const int mc = 64;   // rows of G packed at once, kept in L2
+const int nc = 512;  // columns of H packed at once, kept in L3
+
+using Buffer = std::vector<double, MatrixAllocator<double>>;
+
+// Pairs [k0, k0 + kn) of columns [j0, j0 + jn) of h, in strips of nr
+// columns: for every pair nr values of row 2k + 1, then nr of row 2k.
+// Columns past the end are zeros.
+void PackH(MatrixView<const double> h, int k0, int kn, int j0, int jn,
+           double* out) {
+  for (int s = 0; s < jn; s += nr) {
+    const int width = std::min(nr, jn - s);
+    for (int k = 0; k != kn; ++k, out += 2 * nr) {
+      const double* odd = h[2 * (k0 + k) + 1];
+      const double* even = h[2 * (k0 + k)];
+      for (int c = 0; c != nr; ++c) {
+        out[c] = c < width ? odd[j0 + s + c] : 0;
+        out[nr + c] = c < width ? even[j0 + s + c] : 0;
+      }
+    }
+  }
+}
+
+// Pairs [k0, k0 + kn) of rows [i0, i0 + in) of g, in strips of mr rows: for
+// every pair mr values of column 2k, then mr of column 2k + 1.
+void PackG(MatrixView<const double> g, int k0, int kn, int i0, int in,
+           double* out) {
+  for (int s = 0; s < in; s += mr) {
+    const int height = std::min(mr, in - s);
+    for (int k = 0; k != kn; ++k, out += 2 * mr) {
+      const int col = 2 * (k0 + k);
+      for (int a = 0; a != mr; ++a) {
+        out[a] = a < height ? g[i0 + s + a][col] : 0;
+        out[mr + a] = a < height ? g[i0 + s + a][col + 1] : 0;
+      }
+    }
+  }
+}
+
+// tile (an mr x nr block, rows of nr) += kn packed pairs
+void MicroKernelScalar(const double* gp, const double* hp, int kn,
+                       double* tile) {
+  for (int k = 0; k != kn; ++k, gp += 2 * mr, hp += 2 * nr)
+    for (int a = 0; a != mr; ++a) {
+      const double even = gp[a];
+      const double odd = gp[mr + a];
+      for (int b = 0; b != nr; ++b)
+        tile[a * nr + b] += (even + hp[b]) * (odd + hp[nr + b]);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// a row of the tile is two registers
+__attribute__((target("avx2,fma"))) void MicroKernelAvx2(const double* gp,
+                                                         const double* hp,
+                                                         int kn,
+                                                         double* tile) {
+  __m256d acc[mr][2];
+  for (int a = 0; a != mr; ++a) {
+    acc[a][0] = _mm256_loadu_pd(tile + a * nr);
+    acc[a][1] = _mm256_loadu_pd(tile + a * nr + 4);
+  }
+
+  for (int k = 0; k != kn; ++k, gp += 2 * mr, hp += 2 * nr) {
+    const __m256d odd_lo = _mm256_load_pd(hp);
+    const __m256d odd_hi = _mm256_load_pd(hp + 4);
+    const __m256d even_lo = _mm256_load_pd(hp + nr);
+    const __m256d even_hi = _mm256_load_pd(hp + nr + 4);
+    for (int a = 0; a != mr; ++a) {
+      const __m256d even = _mm256_broadcast_sd(gp + a);
+      const __m256d odd = _mm256_broadcast_sd(gp + mr + a);
+      acc[a][0] = _mm256_fmadd_pd(_mm256_add_pd(even, odd_lo),
+                                  _mm256_add_pd(odd, even_lo), acc[a][0]);
+      acc[a][1] = _mm256_fmadd_pd(_mm256_add_pd(even, odd_hi),
+                                  _mm256_add_pd(odd, even_hi), acc[a][1]);
+    }
+  }
+
+  for (int a = 0; a != mr; ++a) {
+    _mm256_storeu_pd(tile + a * nr, acc[a][0]);
+    _mm256_storeu_pd(tile + a * nr + 4, acc[a][1]);
+  }
+}
+
+// a row of the tile is one register
+__attribute__((target("avx512f"))) void MicroKernelAvx512(const double* gp,
+                                                          const double* hp,
+                                                          int kn,
+                                                          double* tile) {
+  __m512d acc[mr];
+  for (int a = 0; a != mr; ++a) acc[a] = _mm512_loadu_pd(tile + a * nr);
+
+  for (int k = 0; k != kn; ++k, gp += 2 * mr, hp += 2 * nr) {
+    const __m512d odd_h = _mm512_load_pd(hp);
+    const __m512d even_h = _mm512_load_pd(hp + nr);
+    for (int a = 0; a != mr; ++a) {
+      const __m512d even = _mm512_set1_pd(gp[a]);
+      const __m512d odd = _mm512_set1_pd(gp[mr + a]);
+      acc[a] = _mm512_fmadd_pd(_mm512_add_pd(even, odd_h),
+                               _mm512_add_pd(odd, even_h), acc[a]);
+    }
+  }
+
+  for (int a = 0; a != mr; ++a) _mm512_storeu_pd(tile + a * nr, acc[a]);
+}
+
+#endif
+
+using MicroKernel = void (*)(const double*, const double*, int, double*);
+
+MicroKernel ChooseMicroKernel() {
+#if defined(__x86_64__) || defined(__i386__)
+  switch (DetectSimd()) {
+    case SIMD_AVX512:
+      return MicroKernelAvx512;
+    case SIMD_AVX2:
+      return MicroKernelAvx2;
+    default:
+      break;
+  }
+#endif
+  return MicroKernelScalar;
+}
+
+// height x width block of r at (i, j) += kn packed pairs
+void UpdateBlock(MicroKernel kernel, const double* gp, const double* hp,
+                 int kn, MatrixView<double> r, int i, int j, int height,
+                 int width) {
+  alignas(64) double tile[mr * nr] = {};
+  for (int a = 0; a != height; ++a)
+    for (int b = 0; b != width; ++b) tile[a * nr + b] = r[i + a][j + b];
+
+  kernel(gp, hp, kn, tile);
+
+  for (int a = 0; a != height; ++a)
+    for (int b = 0; b != width; ++b) r[i + a][j + b] = tile[a * nr + b];
+}
+
+}  // namespace
+
+void AccumulatePairs(MatrixView<const double> g, MatrixView<const double> h,
+                     MatrixView<double> r) {
+  static const MicroKernel kernel = ChooseMicroKernel();
+
+  const int rows = r.get_rows(), cols = r.get_cols();
+  const int pairs = g.get_cols() / 2;
+  if (pairs <= 0 || rows <= 0 || cols <= 0) return;
+
+  // kept between calls, the tiles of a parallel product call it many times
+  thread_local Buffer h_pack(static_cast<std::size_t>(nc + nr) * 2 * kc);
+  thread_local Buffer g_pack(static_cast<std::size_t>(mc + mr) * 2 * kc);
+
+  for (int j0 = 0; j0 < cols; j0 += nc) {
+    const int jn = std::min(nc, cols - j0);
+
+    // pair panels in order, so every sum keeps the order of the plain loop
+    for (int k0 = 0; k0 < pairs; k0 += kc) {
+      const int kn = std::min(kc, pairs - k0);
+      PackH(h, k0, kn, j0, jn, h_pack.data());
+
+      for (int i0 = 0; i0 < rows; i0 += mc) {
+        const int in = std::min(mc, rows - i0);
+        PackG(g, k0, kn, i0, in, g_pack.data());
+
+        for (int s = 0; s < jn; s += nr)
+          for (int t = 0; t < in; t += mr)
+            UpdateBlock(kernel, g_pack.data() + t * 2 * kn,
+                        h_pack.data() + s * 2 * kn, kn, r, i0 + t, j0 + s,
+                        std::min(mr, in - t), std::min(nr, jn - s));
+      }
+    }
+  }
+}
+
+}  // namespace winograd
@@ -0,0 +1,22 @@
+#ifndef WINOGRAD_KERNELS_H_
+#define WINOGRAD_KERNELS_H_
+
+#include "../matrixview.h"
+
+namespace winograd {
+
+// r[i][j] += (g[i][2k] + h[2k + 1][j]) * (g[i][2k + 1] + h[2k][j]) for every
+// entry of r and every pair k of the common dimension, in order; g has the
+// rows of r and h its columns, any of them can be a block of a bigger
+// matrix. Pairs of G and H are packed into cache-sized panels and every sum
+// is built in a register tile, in the same order as the plain loop. The
+// tile uses the widest vector unit of the CPU; the AVX2 and AVX-512
+// variants fuse the multiply and add, so their last bits may differ from
+// the scalar one, but a given CPU always gives the same results whatever
+// the blocking or the number of threads.
+void AccumulatePairs(MatrixView<const double> g, MatrixView<const double> h,
+                     MatrixView<double> r);
+
+}  // namespace winograd
+
+#endif  // WINOGRAD_KERNELS_H_
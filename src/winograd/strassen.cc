@@ -0,0 +1,210 @@
+#include <omp.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "../matrixallocator.h"
+#include "winograd.h"
+
+namespace winograd {
+
+namespace {
+
+// temporaries come back to the pool for the next level or product
+using Buffer = std::vector<double, PoolAllocator<double>>;
+
+using In = Winograd::ConstView;
+using Out = Winograd::View;
+
+Out Allocate(Buffer& buffer, int rows, int cols) {
+  const std::size_t stride = PaddedRowStride<double>(cols);
+  buffer.resize(rows * stride);
+  return {buffer.data(), rows, cols, stride};
+}
+
+// z = x + y and z = x - y; z may be x or y, entry for entry
+void Add(In x, In y, Out z) {
+  for (int i = 0; i != z.get_rows(); ++i) {
+    const double *xi = x[i], *yi = y[i];
+    double* zi = z[i];
+#pragma omp simd
+    for (int j = 0; j < z.get_cols(); ++j) zi[j] = xi[j] + yi[j];
+  }
+}
+
+void Sub(In x, In y, Out z) {
+  for (int i = 0; i != z.get_rows(); ++i) {
+    const double *xi = x[i], *yi = y[i];
+    double* zi = z[i];
+#pragma omp simd
+    for (int j = 0; j < z.get_cols(); ++j) zi[j] = xi[j] - yi[j];
+  }
+}
+
+void Product(In a, In b, Out c, int cutoff, int parallel_levels);
+
+// c = a * b for even sizes, seven half-size products of the Strassen-Winograd
+// form. With parallel_levels left the products are tasks, and all of them
+// need their own temporaries; otherwise they run one by one, the quarters of
+// c and two temporaries holding every intermediate (Boyer, Dumas, Pernet and
+// Zhou, "Memory efficient scheduling of Strassen-Winograd's matrix
+// multiplication algorithm").
+void Recurse(In a, In b, Out c, int cutoff, int parallel_levels) {
+  const int m = a.get_rows() / 2, k = a.get_cols() / 2, n = b.get_cols() / 2;
+  const In a11 = a.Block(0, 0, m, k), a12 = a.Block(0, k, m, k);
+  const In a21 = a.Block(m, 0, m, k), a22 = a.Block(m, k, m, k);
+  const In b11 = b.Block(0, 0, k, n), b12 = b.Block(0, n, k, n);
+  const In b21 = b.Block(k, 0, k, n), b22 = b.Block(k, n, k, n);
+  const Out c11 = c.Block(0, 0, m, n), c12 = c.Block(0, n, m, n);
+  const Out c21 = c.Block(m, 0, m, n), c22 = c.Block(m, n, m, n);
+
+  if (parallel_levels > 0) {
+    --parallel_levels;
+    Buffer buffers[11];
+    const Out s1 = Allocate(buffers[0], m, k), s2 = Allocate(buffers[1], m, k);
+    const Out s3 = Allocate(buffers[2], m, k), s4 = Allocate(buffers[3], m, k);
+    const Out t1 = Allocate(buffers[4], k, n), t2 = Allocate(buffers[5], k, n);
+    const Out t3 = Allocate(buffers[6], k, n), t4 = Allocate(buffers[7], k, n);
+    const Out p1 = Allocate(buffers[8], m, n), p6 = Allocate(buffers[9], m, n);
+    const Out p7 = Allocate(buffers[10], m, n);
+
+    Add(a21, a22, s1);
+    Sub(s1, a11, s2);
+    Sub(a11, a21, s3);
+    Sub(a12, s2, s4);
+    Sub(b12, b11, t1);
+    Sub(b22, t1, t2);
+    Sub(b22, b12, t3);
+    Sub(t2, b21, t4);
+
+    // p2..p5 go straight into the quarters of c they end up in
+#pragma omp task
+    Product(a11, b11, p1, cutoff, parallel_levels);
+#pragma omp task
+    Product(a12, b21, c11, cutoff, parallel_levels);
+#pragma omp task
+    Product(s4, b22, c12, cutoff, parallel_levels);
+#pragma omp task
+    Product(a22, t4, c21, cutoff, parallel_levels);
+#pragma omp task
+    Product(s1, t1, c22, cutoff, parallel_levels);
+#pragma omp task
+    Product(s2, t2, p6, cutoff, parallel_levels);
+    Product(s3, t3, p7, cutoff, parallel_levels);
+#pragma omp taskwait
+
+    Add(c11, p1, c11);   // p1 + p2
+    Add(p1, p6, p6);     // u2 = p1 + p6
+    Add(p6, p7, p7);     // u3 = u2 + p7
+    Add(c12, p6, c12);   // p3 + u2
+    Add(c12, c22, c12);  // + p5
+    Sub(p7, c21, c21);   // u3 - p4
+    Add(p7, c22, c22);   // u3 + p5
+    return;
+  }
+
+  Buffer x_buffer, y_buffer;
+  const Out xy = Allocate(x_buffer, m, std::max(k, n));
+  const Out x = xy.Block(0, 0, m, k), p1 = xy.Block(0, 0, m, n);
+  const Out y = Allocate(y_buffer, k, n);
+
+  Sub(a11, a21, x);                   // s3
+  Sub(b22, b12, y);                   // t3
+  Product(x, y, c21, cutoff, 0);      // p7
+  Add(a21, a22, x);                   // s1
+  Sub(b12, b11, y);                   // t1
+  Product(x, y, c22, cutoff, 0);      // p5
+  Sub(x, a11, x);                     // s2
+  Sub(b22, y, y);                     // t2
+  Product(x, y, c12, cutoff, 0);      // p6
+  Sub(a12, x, x);                     // s4
+  Product(x, b22, c11, cutoff, 0);    // p3
+  Product(a11, b11, p1, cutoff, 0);   // p1
+  Add(p1, c12, c12);                  // u2 = p1 + p6
+  Add(c12, c21, c21);                 // u3 = u2 + p7
+  Add(c12, c22, c12);                 // u4 = u2 + p5
+  Add(c21, c22, c22);                 // u7 = u3 + p5
+  Add(c12, c11, c12);                 // u5 = u4 + p3
+  Sub(y, b21, y);                     // t4
+  Product(a22, y, c11, cutoff, 0);    // p4
+  Sub(c21, c11, c21);                 // u6 = u3 - p4
+  Product(a12, b21, c11, cutoff, 0);  // p2
+  Add(p1, c11, c11);                  // u1 = p1 + p2
+}
+
+// c = a * b. Odd sizes are peeled: the even part recurses, and the last
+// row, column or pair of the common dimension is added by plain loops.
+void Product(In a, In b, Out c, int cutoff, int parallel_levels) {
+  const int m = a.get_rows(), k = a.get_cols(), n = b.get_cols();
+  if (std::min({m, k, n}) <= cutoff) {
+    Winograd::MultiplyInto(c, a, b);
+    return;
+  }
+
+  const int me = m & ~1, ke = k & ~1, ne = n & ~1;
+  const Out core = c.Block(0, 0, me, ne);
+  Recurse(a.Block(0, 0, me, ke), b.Block(0, 0, ke, ne), core, cutoff,
+          parallel_levels);
+
+  if (ke != k)
+    for (int i = 0; i != me; ++i)
+      for (int j = 0; j != ne; ++j) core[i][j] += a[i][k - 1] * b[k - 1][j];
+
+  if (ne != n)
+    for (int i = 0; i != m; ++i) {
+      double sum = 0;
+      for (int p = 0; p != k; ++p) sum += a[i][p] * b[p][n - 1];
+      c[i][n - 1] = sum;
+    }
+
+  if (me != m)
+    for (int j = 0; j != ne; ++j) {
+      double sum = 0;
+      for (int p = 0; p != k; ++p) sum += a[m - 1][p] * b[p][j];
+      c[m - 1][j] = sum;
+    }
+}
+
+}  // namespace
+
+SimpleGraph<double> Winograd::StrassenMultiply(const SimpleGraph<double>& g,
+                                               const SimpleGraph<double>& h,
+                                               int num_threads, int cutoff) {
+  SimpleGraph<double> r(g.get_rows(), h.get_cols());
+  StrassenMultiplyInto(r, g, h, num_threads, cutoff);
+  return r;
+}
+
+void Winograd::StrassenMultiplyInto(View r, ConstView g, ConstView h,
+                                    int num_threads, int cutoff) {
+  if (g.get_cols() != h.get_rows())
+    throw std::invalid_argument("Incorrect matrix size for miltiplication");
+  if (r.get_rows() != g.get_rows() || r.get_cols() != h.get_cols())
+    throw std::invalid_argument("Incorrect size of the result matrix");
+  if (num_threads < 1)
+    throw std::invalid_argument("Number of threads should be positive");
+  if (cutoff < 16)
+    throw std::invalid_argument("Strassen cutoff should be 16 or more");
+
+  // temporaries of one size are reused by the levels and products below
+  MatrixPool::Scope pool_scope;
+
+  // levels of tasks until there are enough products for every thread
+  int parallel_levels = 0;
+  for (int products = 1; products < num_threads; products *= 7)
+    ++parallel_levels;
+
+  if (parallel_levels == 0 ||
+      std::min({g.get_rows(), g.get_cols(), h.get_cols()}) <= cutoff) {
+    Product(g, h, r, cutoff, 0);
+    return;
+  }
+
+#pragma omp parallel num_threads(num_threads)
+#pragma omp single
+  Product(g, h, r, cutoff, parallel_levels);
+}
+
+}  // namespace winograd
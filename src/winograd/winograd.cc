@@ -1,79 +1,182 @@
 #include "winograd.h"
 
-#include <omp.h>
-
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <thread>
 
-namespace winograd {
+#include "../spscqueue.h"
+#include "../threadpool.h"
+#include "kernels.h"
 
-SimpleGraph<double> Winograd::Multiply(const SimpleGraph<double>& g,
-                                       const SimpleGraph<double>& h) {
-  if (g.get_cols() != h.get_rows())
-    throw std::invalid_argument("Incorrect matrix size for miltiplication");
-
-  int a = g.get_rows();
-  int b = g.get_cols();
+namespace winograd {
 
-  int c = h.get_cols();
-  int d = b / 2;
+namespace {
+
+// Hands out tiles [0, count) to workers. Every worker starts on its own
+// contiguous range, so neighbouring tiles share cached panels, and once it
+// runs dry takes the second half of the fullest range left.
+class TileScheduler {
+ public:
+  TileScheduler(int count, int workers) : ranges_(workers) {
+    for (int w = 0; w != workers; ++w) {
+      ranges_[w].begin = ThreadPool::BlockBegin(count, workers, w);
+      ranges_[w].end = ThreadPool::BlockBegin(count, workers, w + 1);
+    }
+  }
 
-  std::vector<double> rowFactor(a);
-  std::vector<double> colFactor(c);
+  // next tile for worker, or -1 when none are left
+  int Next(int worker) {
+    Range& own = ranges_[worker];
+    {
+      std::lock_guard<std::mutex> lock(own.mtx);
+      if (own.begin != own.end) return own.begin++;
+    }
 
-  SimpleGraph<double> r(a, c);
+    while (true) {
+      int victim = -1, most = 0;
+      for (int w = 0; w != static_cast<int>(ranges_.size()); ++w) {
+        std::lock_guard<std::mutex> lock(ranges_[w].mtx);
+        if (ranges_[w].end - ranges_[w].begin > most) {
+          most = ranges_[w].end - ranges_[w].begin;
+          victim = w;
+        }
+      }
+      if (victim == -1) return -1;
+
+      int first, last;
+      {
+        std::lock_guard<std::mutex> lock(ranges_[victim].mtx);
+        Range& from = ranges_[victim];
+        if (from.begin == from.end) continue;
+        first = from.begin + (from.end - from.begin) / 2;
+        last = from.end;
+        from.end = first;
+      }
 
-  // вычисление rowFactors для G
-  for (int i = 0; i != a; ++i) {
-    rowFactor[i] = g[i][0] * g[i][1];
-    for (int j = 1; j != d; ++j) {
-      rowFactor[i] += g[i][2 * j] * g[i][2 * j + 1];
+      // nobody else adds to an empty range, so it is ours to refill
+      std::lock_guard<std::mutex> lock(own.mtx);
+      own.begin = first + 1;
+      own.end = last;
+      return first;
     }
   }
 
-  // вычисление columnFactor для H
-  for (int i = 0; i != c; ++i) {
-    colFactor[i] = h[0][i] * h[1][i];
-    for (int j = 1; j != d; ++j) {
-      colFactor[i] += h[2 * j][i] * h[2 * j + 1][i];
+ private:
+  struct alignas(64) Range {
+    std::mutex mtx;
+    int begin{0};
+    int end{0};
+  };
+
+  std::vector<Range> ranges_;
+};
+
+// Tiles of an a x c result for threads workers: they start at 256 x 512
+// and shrink until there are 4 or more per thread, or they can not shrink.
+struct Tiling {
+  Tiling(int a, int c, int threads) {
+    auto bands = [](int size, int tile) { return (size + tile - 1) / tile; };
+    while (bands(a, rows) * bands(c, cols) < 4 * threads) {
+      bool split_rows = rows > 16 && a > rows;
+      bool split_cols = cols > 64 && c > cols;
+      if (!split_rows && !split_cols) break;
+      if (split_rows && (!split_cols || 4 * rows >= cols))
+        rows /= 2;
+      else
+        cols /= 2;
     }
+    row_bands = bands(a, rows);
+    col_bands = bands(c, cols);
   }
 
-  // вычисление матрицы R
-  for (int i = 0; i != a; ++i) {
-    for (int j = 0; j != c; ++j) {
+  int Count() const { return row_bands * col_bands; }
+
+  int rows{256};
+  int cols{512};
+  int row_bands;
+  int col_bands;
+};
+
+// Calls func(pool) with a pool of threads workers kept for the whole
+// process, so that repeated products do not start their threads again. It
+// is made anew when another number of workers is asked for; products going
+// through it run one at a time.
+void WithSharedPool(int threads, const std::function<void(ThreadPool&)>& func) {
+  static std::mutex mtx;
+  static std::unique_ptr<ThreadPool> pool;
+
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!pool || pool->Size() != threads) {
+    pool.reset();
+    pool = std::make_unique<ThreadPool>(threads);
+  }
+  func(*pool);
+}
+
+void CheckSizes(Winograd::View r, Winograd::ConstView g,
+                Winograd::ConstView h) {
+  if (g.get_cols() != h.get_rows())
+    throw std::invalid_argument("Incorrect matrix size for miltiplication");
+  if (r.get_rows() != g.get_rows() || r.get_cols() != h.get_cols())
+    throw std::invalid_argument("Incorrect size of the result matrix");
+}
+
+// R в строках [i0, i1) и столбцах [j0, j1) по готовым rowFactor и colFactor
+void ComputeBlock(Winograd::View r, Winograd::ConstView g,
+                  Winograd::ConstView h, const std::vector<double>& rowFactor,
+                  const std::vector<double>& colFactor, int i0, int i1, int j0,
+                  int j1) {
+  const int b = g.get_cols();
+  if (i0 == i1 || j0 == j1) return;
+
+  for (int i = i0; i != i1; ++i) {
+    for (int j = j0; j != j1; ++j) {
       r[i][j] = -rowFactor[i] - colFactor[j];
-      for (int k = 0; k != d; ++k) {
-        r[i][j] +=
-            (g[i][2 * k] + h[2 * k + 1][j]) * (g[i][2 * k + 1] + h[2 * k][j]);
-      }
     }
   }
+  AccumulatePairs(g.Block(i0, 0, i1 - i0, b), h.Block(0, j0, b, j1 - j0),
+                  r.Block(i0, j0, i1 - i0, j1 - j0));
 
   // прибавление членов в случае нечетной общей размерности
-  if (2 * d != b) {
-    for (int i = 0; i != a; ++i) {
-      for (int j = 0; j != c; ++j) {
+  if (b % 2 != 0) {
+    for (int i = i0; i != i1; ++i) {
+      for (int j = j0; j != j1; ++j) {
         r[i][j] += g[i][b - 1] * h[b - 1][j];
       }
     }
   }
+}
 
+}  // namespace
+
+SimpleGraph<double> Winograd::Multiply(const SimpleGraph<double>& g,
+                                       const SimpleGraph<double>& h) {
+  SimpleGraph<double> r(g.get_rows(), h.get_cols());
+  MultiplyInto(r, g, h);
   return r;
 }
 
 SimpleGraph<double> Winograd::AsyncMultiply(const SimpleGraph<double>& g,
                                             const SimpleGraph<double>& h,
                                             int num_threads) {
-  if (g.get_cols() != h.get_rows())
-    throw std::invalid_argument("Incorrect matrix size for miltiplication");
+  SimpleGraph<double> r(g.get_rows(), h.get_cols());
+  AsyncMultiplyInto(r, g, h, num_threads);
+  return r;
+}
 
-  int n = std::thread::hardware_concurrency();
-  if (num_threads < 2 || num_threads > n * 4)
-    throw std::invalid_argument("Number o threads should be in [2; 4*cpu's]");
-  if (num_threads % 2 != 0)
-    throw std::invalid_argument("Number of threads should be even.");
+SimpleGraph<double> Winograd::AsyncPipelineMultiply(
+    const SimpleGraph<double>& g, const SimpleGraph<double>& h, int stages,
+    int queue_depth) {
+  SimpleGraph<double> r(g.get_rows(), h.get_cols());
+  AsyncPipelineMultiplyInto(r, g, h, stages, queue_depth);
+  return r;
+}
 
-  omp_set_num_threads(num_threads);
+void Winograd::MultiplyInto(View r, ConstView g, ConstView h) {
+  CheckSizes(r, g, h);
 
   int a = g.get_rows();
   int b = g.get_cols();
@@ -82,98 +185,148 @@ SimpleGraph<double> Winograd::AsyncMultiply(const SimpleGraph<double>& g,
   int d = b / 2;
 
   std::vector<double> rowFactor(a);
-  std::vector<double> columnFactor(c);
-
-  SimpleGraph<double> r(a, c);
-
-  // вычисление rowFactors для G
-#pragma omp parallel for
-  for (int i = 0; i != a; ++i) {
-    rowFactor[i] = g[i][0] * g[i][1];
-    for (int j = 1; j != d; ++j) {
-      rowFactor[i] += g[i][2 * j] * g[i][2 * j + 1];
-    }
-  }
+  std::vector<double> colFactor(c);
 
-  // вычисление columnFactor для H
-#pragma omp parallel for
-  for (int i = 0; i != c; ++i) {
-    columnFactor[i] = h[0][i] * h[1][i];
-    for (int j = 1; j != d; ++j) {
-      columnFactor[i] += h[2 * j][i] * h[2 * j + 1][i];
-    }
-  }
+  // вычисление rowFactors для G и columnFactor для H, по строкам H
+  RowFactorCompute(g, rowFactor, 0, a, d);
+  ColFactorCompute(h, colFactor, 0, c, d);
 
   // вычисление матрицы R
-#pragma omp parallel for
-  for (int i = 0; i != a; ++i) {
-    for (int j = 0; j != c; ++j) {
-      r[i][j] = -rowFactor[i] - columnFactor[j];
-      for (int k = 0; k != d; ++k) {
-        r[i][j] +=
-            (g[i][2 * k] + h[2 * k + 1][j]) * (g[i][2 * k + 1] + h[2 * k][j]);
-      }
-    }
-  }
-
-  // прибавление членов в случае нечетной общей размерности
-  if (2 * d != b) {
-#pragma omp parallel for
-    for (int i = 0; i != a; ++i) {
-      for (int j = 0; j != c; ++j) {
-        r[i][j] += g[i][b - 1] * h[b - 1][j];
-      }
-    }
-  }
+  ComputeBlock(r, g, h, rowFactor, colFactor, 0, a, 0, c);
+}
 
-  return r;
+void Winograd::AsyncMultiplyInto(View r, ConstView g, ConstView h,
+                                 int num_threads) {
+  CheckSizes(r, g, h);
+  if (num_threads < 1)
+    throw std::invalid_argument("Number of threads should be positive");
+  // пустой результат: считать нечего, пул не нужен
+  if (r.get_rows() == 0 || r.get_cols() == 0) return;
+
+  const int tiles = Tiling(g.get_rows(), h.get_cols(), num_threads).Count();
+  WithSharedPool(std::min(num_threads, tiles), [&](ThreadPool& pool) {
+    AsyncMultiplyInto(r, g, h, pool);
+  });
 }
 
-SimpleGraph<double> Winograd::AsyncPipelineMultiply(
-    const SimpleGraph<double>& g, const SimpleGraph<double>& h) {
-  if (g.get_cols() != h.get_rows())
-    throw std::invalid_argument("Incorrect matrix size for miltiplication");
+void Winograd::AsyncMultiplyInto(View r, ConstView g, ConstView h,
+                                 ThreadPool& pool) {
+  CheckSizes(r, g, h);
 
   int a = g.get_rows();
   int b = g.get_cols();
+
   int c = h.get_cols();
   int d = b / 2;
 
+  const Tiling tiling(a, c, pool.Size());
+  const int tile_rows = tiling.rows, tile_cols = tiling.cols;
+  const int row_bands = tiling.row_bands, col_bands = tiling.col_bands;
+  // лишние потоки пула в умножении не участвуют
+  const int workers = std::min(pool.Size(), tiling.Count());
+
   std::vector<double> rowFactor(a);
-  std::vector<double> colFactor(c);
+  std::vector<double> columnFactor(c);
+  std::vector<std::once_flag> row_band_ready(row_bands);
+  std::vector<std::once_flag> col_band_ready(col_bands);
+
+  auto tile = [&](int t) {
+    const int i0 = t / col_bands * tile_rows;
+    const int i1 = std::min(a, i0 + tile_rows);
+    const int j0 = t % col_bands * tile_cols;
+    const int j1 = std::min(c, j0 + tile_cols);
+
+    // rowFactors и columnFactor полосы считает первая плитка, которой они
+    // нужны
+    std::call_once(row_band_ready[i0 / tile_rows],
+                   [&] { RowFactorCompute(g, rowFactor, i0, i1, d); });
+    std::call_once(col_band_ready[j0 / tile_cols],
+                   [&] { ColFactorCompute(h, columnFactor, j0, j1, d); });
+
+    ComputeBlock(r, g, h, rowFactor, columnFactor, i0, i1, j0, j1);
+  };
+
+  TileScheduler scheduler(tiling.Count(), workers);
+  pool.Run([&](int worker) {
+    if (worker >= workers) return;
+    for (int t; (t = scheduler.Next(worker)) != -1;) tile(t);
+  });
+}
 
-  SimpleGraph<double> r(a, c);
+void Winograd::AsyncPipelineMultiplyInto(View r, ConstView g, ConstView h,
+                                         int stages, int queue_depth) {
+  CheckSizes(r, g, h);
+  if (stages == 0)
+    stages = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+  if (stages < 2)
+    throw std::invalid_argument("A pipeline needs 2 or more stages");
+  if (queue_depth < 1)
+    throw std::invalid_argument("Queue depth should be positive");
+
+  WithSharedPool(stages, [&](ThreadPool& pool) {
+    AsyncPipelineMultiplyInto(r, g, h, pool, queue_depth);
+  });
+}
 
-  std::thread row_fact_thread(RowFactorCompute, std::cref(g),
-                              std::ref(rowFactor), a, d);
-  std::thread col_fact_thread(ColFactorCompute, std::cref(h),
-                              std::ref(colFactor), c, d);
+void Winograd::AsyncPipelineMultiplyInto(View r, ConstView g, ConstView h,
+                                         ThreadPool& pool, int queue_depth) {
+  CheckSizes(r, g, h);
+  if (pool.Size() < 2)
+    throw std::invalid_argument("A pipeline needs 2 or more stages");
+  if (queue_depth < 1)
+    throw std::invalid_argument("Queue depth should be positive");
 
-  row_fact_thread.join();
-  col_fact_thread.join();
+  int a = g.get_rows();
+  int b = g.get_cols();
+  int c = h.get_cols();
+  int d = b / 2;
 
-  for (int i = 0; i != a; ++i) {
-    for (int j = 0; j != c; ++j) {
-      r[i][j] = -rowFactor[i] - colFactor[j];
-      for (int k = 0; k != d; ++k) {
-        r[i][j] +=
-            (g[i][2 * k] + h[2 * k + 1][j]) * (g[i][2 * k + 1] + h[2 * k][j]);
-      }
-    }
-  }
+  std::vector<double> rowFactor(a);
+  std::vector<double> colFactor(c);
 
-  std::thread ifeven_thread([=, &r, &g, &h]() {
-    if (2 * d != b) {
-      for (int i = 0; i != a; ++i) {
-        for (int j = 0; j != c; ++j) {
-          r[i][j] += g[i][b - 1] * h[b - 1][j];
+  const int block = 128;
+  const int blocks = (a + block - 1) / block;
+  const int slices = pool.Size() - 1;
+
+  // очередь готовых блоков rowFactor для каждой стадии R
+  std::vector<std::unique_ptr<SpscQueue<int>>> ready(slices);
+  for (auto& queue : ready)
+    queue = std::make_unique<SpscQueue<int>>(queue_depth);
+  // выставляет упавшая стадия, чтобы остальные не ждали её вечно
+  std::atomic<bool> cancel{false};
+
+  pool.Run([&](int stage) {
+    try {
+      // стадия 0: rowFactors по блокам строк, каждый блок сразу уходит всем
+      // остальным стадиям
+      if (stage == 0) {
+        for (int k = 0; k != blocks; ++k) {
+          const int i0 = k * block;
+          RowFactorCompute(g, rowFactor, i0, std::min(a, i0 + block), d);
+          for (auto& queue : ready)
+            if (!queue->Push(k, cancel)) return;
         }
+        return;
+      }
+
+      // остальные стадии: свои столбцы R, блок за блоком, вместе с
+      // прибавлением членов в случае нечетной общей размерности
+      const int j0 = ThreadPool::BlockBegin(c, slices, stage - 1);
+      const int j1 = ThreadPool::BlockBegin(c, slices, stage);
+      ColFactorCompute(h, colFactor, j0, j1, d);
+
+      for (int n = 0; n != blocks; ++n) {
+        int k;
+        if (!ready[stage - 1]->Pop(k, cancel)) return;
+        const int i0 = k * block;
+        ComputeBlock(r, g, h, rowFactor, colFactor, i0,
+                     std::min(a, i0 + block), j0, j1);
       }
+    } catch (...) {
+      cancel = true;
+      throw;
     }
   });
-  ifeven_thread.join();
-
-  return r;
 }
 
 }  // namespace winograd
@@ -1,38 +1,99 @@
 #ifndef WINOGRAD_H_
 #define WINOGRAD_H_
 
+#include <vector>
+
+#include "../matrixview.h"
 #include "../simplegraph.h"
+#include "../threadpool.h"
 
 namespace winograd {
 
 class Winograd {
  public:
+  using View = MatrixView<double>;
+  using ConstView = MatrixView<const double>;
+
   static SimpleGraph<double> Multiply(const SimpleGraph<double>& g,
                                       const SimpleGraph<double>& h);
+  // Multiply on num_threads workers: tiles of the result are shared out in
+  // contiguous runs and stolen by whoever runs out, each computing the
+  // factors of its rows and columns first if nobody has yet. Same bits as
+  // Multiply for any number of threads. The threads are kept between calls
+  // in a pool of the process, started anew only for another number of
+  // them, and there are never more of them than tiles.
   static SimpleGraph<double> AsyncMultiply(const SimpleGraph<double>& g,
                                            const SimpleGraph<double>& h,
                                            int num_threads);
+
+  // entries of every queue between the stages of AsyncPipelineMultiply
+  static constexpr int pipeline_depth = 4;
+
+  // Multiply as a pipeline of stages threads (0 for one per core, 2 at
+  // least). The first computes rowFactor block by block of rows and hands
+  // every block over bounded lock-free queues of queue_depth entries to the
+  // others; each of them owns a slice of the columns of R, computes their
+  // colFactor, then finishes its part of every block as it arrives, the odd
+  // column included. A stage that throws stops the others, and the
+  // exception reaches the caller. Same bits as Multiply. The threads are
+  // kept between calls, as with AsyncMultiply.
   static SimpleGraph<double> AsyncPipelineMultiply(
-      const SimpleGraph<double>& g, const SimpleGraph<double>& h);
+      const SimpleGraph<double>& g, const SimpleGraph<double>& h,
+      int stages = 0, int queue_depth = pipeline_depth);
+
+  // sizes at which Strassen's recursion hands blocks to Multiply
+  static constexpr int strassen_cutoff = 512;
+
+  // Strassen-Winograd recursion, 7 half-size products a level, down to
+  // blocks with a side of cutoff or less; odd sides are peeled off. Top
+  // levels run their products as num_threads OpenMP tasks. Rounding errors
+  // grow somewhat faster than with Multiply.
+  static SimpleGraph<double> StrassenMultiply(const SimpleGraph<double>& g,
+                                              const SimpleGraph<double>& h,
+                                              int num_threads,
+                                              int cutoff = strassen_cutoff);
+
+  // The products above written into r, which must be g.get_rows() x
+  // h.get_cols() and must not overlap g or h. Any of the three can be a
+  // block of a bigger matrix or a buffer of the caller; the result itself
+  // is never allocated, so repeated products reuse the same storage.
+  static void MultiplyInto(View r, ConstView g, ConstView h);
+  static void AsyncMultiplyInto(View r, ConstView g, ConstView h,
+                                int num_threads);
+  // on the workers of a pool of the caller
+  static void AsyncMultiplyInto(View r, ConstView g, ConstView h,
+                                ThreadPool& pool);
+  static void AsyncPipelineMultiplyInto(View r, ConstView g, ConstView h,
+                                        int stages = 0,
+                                        int queue_depth = pipeline_depth);
+  // one stage on every worker of a pool of the caller, 2 or more
+  static void AsyncPipelineMultiplyInto(View r, ConstView g, ConstView h,
+                                        ThreadPool& pool,
+                                        int queue_depth = pipeline_depth);
+  static void StrassenMultiplyInto(View r, ConstView g, ConstView h,
+                                   int num_threads,
+                                   int cutoff = strassen_cutoff);
 
  private:
-  static void RowFactorCompute(const SimpleGraph<double>& g,
-                               std::vector<double>& row_fact, int row,
-                               int col) {
-    for (int i = 0; i != row; ++i) {
-      row_fact[i] = g[i][0] * g[i][1];
-      for (int j = 1; j != col; ++j) {
+  // rowFactor of rows [first, last) of g and colFactor of columns
+  // [first, last) of h, the latter row by row of h
+  static void RowFactorCompute(ConstView g, std::vector<double>& row_fact,
+                               int first, int last, int pairs) {
+    for (int i = first; i != last; ++i) {
+      row_fact[i] = pairs ? g[i][0] * g[i][1] : 0;
+      for (int j = 1; j < pairs; ++j) {
         row_fact[i] += g[i][2 * j] * g[i][2 * j + 1];
       }
     }
   }
 
-  static void ColFactorCompute(const SimpleGraph<double>& h,
-                               std::vector<double>& col_fact, int row,
-                               int col) {
-    for (int i = 0; i != row; ++i) {
-      col_fact[i] = h[0][i] * h[1][i];
-      for (int j = 1; j != col; ++j) {
+  static void ColFactorCompute(ConstView h, std::vector<double>& col_fact,
+                               int first, int last, int pairs) {
+    for (int i = first; i != last; ++i) {
+      col_fact[i] = pairs ? h[0][i] * h[1][i] : 0;
+    }
+    for (int j = 1; j < pairs; ++j) {
+      for (int i = first; i != last; ++i) {
         col_fact[i] += h[2 * j][i] * h[2 * j + 1][i];
       }
     }